@@ -22,6 +22,10 @@
 #ifdef ENABLE_BENCHMARKING
 #include <benchmark/benchmark.h>
 #endif
+// Defined when linked into the command-line driver, see driver.cpp.
+#ifdef PUZZLE_DRIVER
+#include "driver.hpp"
+#endif
 
 enum actor {
     cabbage, goat, wolf
@@ -31,39 +35,42 @@ enum class pos_t {
 }; // names of the actor positions
 using actors_t = std::array<pos_t, 3>; // positions of the actors
 
-// Overload to print position of actor
-std::ostream &operator<<(std::ostream &os, pos_t &position) {
+// The character printed for the position of an actor
+char symbol(pos_t position) {
     switch (position) {
         case pos_t::shore1:
-            return os << "1";
+            return '1';
         case pos_t::travel:
-            return os << "~";
-        case pos_t::shore2:
-            return os << "2";
+            return '~';
         default:
-            return os << "Something went wrong!";
+            return '2';
     }
 }
 
+// Overload to print position of actor
+std::ostream &operator<<(std::ostream &os, const pos_t &position) {
+    return os << symbol(position);
+}
+
 // Overload to print actor
-std::ostream &operator<<(std::ostream &os, actors_t &actors) {
+std::ostream &operator<<(std::ostream &os, const actors_t &actors) {
     // Print position of cabbage, then goat and finally wolf
     return os << actors[actor::cabbage] << actors[actor::goat] << actors[actor::wolf];
 }
 
 // Overload of << operator to print array content
 template<class StateT, template<class...> class ContainerT>
-std::ostream &operator<<(std::ostream &os, ContainerT<std::array<StateT, 3>> &arr) {
+std::ostream &operator<<(std::ostream &os, const ContainerT<std::array<StateT, 3>> &arr) {
     // Incremental value to keep track of the current step
     int i = 0;
-    for (auto content : arr) {
-        os << i++ << ": " << content << std::endl;
+    for (auto &content : arr) {
+        os << i++ << ": " << content << '\n';
     }
     return os;
 }
 
 auto transitions(const actors_t &actors) {
-    auto res = std::list<std::function<void(actors_t &)>>{};
+    auto res = transitions_t<actors_t>{};
     for (auto i = 0u; i < actors.size(); ++i)
         switch (actors[i]) {
             case pos_t::shore1:
@@ -96,17 +103,38 @@ bool is_valid(const actors_t &actors) {
 void solve() {
     auto state_space = state_space_t{
             actors_t{},                // initial state
-            successors<actors_t>(transitions), // successor generator from your library
+            successors<actors_t, std::list>(transitions), // successor generator from your library
             &is_valid};                        // invariant over all states
     auto solution = state_space.check(
             [](const actors_t &actors) { // all actors should be on the shore2:
-                return std::count(std::begin(actors), std::end(actors), pos_t::shore2) == actors.size();
+                return std::all_of(std::begin(actors), std::end(actors),
+                                   [](pos_t pos) { return pos == pos_t::shore2; });
             });
     for (auto &&trace: solution)
         std::cout << "#  CGW\n" << trace;
 }
 
-#ifndef ENABLE_BENCHMARKING
+#ifdef PUZZLE_DRIVER
+// Formats a trace state for trace_writer_t as the overloads above print it, with its step.
+void format(trace_writer_t &out, const actors_t &actors, std::size_t step) {
+    out << step << ": " << symbol(actors[actor::cabbage]) << symbol(actors[actor::goat]) << symbol(actors[actor::wolf]);
+}
+
+static model_registration_t crossing_model{
+        "crossing", "goat, cabbage and wolf river crossing",
+        [](const run_config_t &config, trace_writer_t &out) {
+            auto space = state_space_t{actors_t{}, successors<actors_t, std::list>(transitions), &is_valid};
+            return search(
+                    config, space,
+                    [](const actors_t &actors) {
+                        return std::all_of(std::begin(actors), std::end(actors),
+                                           [](pos_t pos) { return pos == pos_t::shore2; });
+                    },
+                    [&](std::list<actors_t> &&trace) { write_trace(config, out, trace, format); });
+        }};
+#endif
+
+#if !defined(ENABLE_BENCHMARKING) && !defined(PUZZLE_DRIVER)
 int main() {
     solve();
 }
@@ -0,0 +1,368 @@
+/**
+ * Command-line driver running the registered puzzle models with tuning flags, see driver.hpp.
+ * Compile and run:
+ * g++ -std=c++17 -pedantic -Wall -DNDEBUG -DPUZZLE_DRIVER -O3 -o driver driver.cpp frogs.cpp crossing.cpp family.cpp \
+ *     -lpthread && ./driver --model frogs --size 4
+ * A batch file holds one configuration per line, as flags over those of the command line, and is run on --jobs
+ * processes at once, each run reporting its time and peak memory on standard error:
+ * ./driver --batch runs.txt --jobs 4 --format none
+ * A parallel search writes the same traces for any number of threads, which is checked by:
+ * ./driver --model family --variant older-son-noise --compare-threads 8
+ * A slow search is recorded once and replayed under a profiler, or compared with the search of another build:
+ * ./driver --model frogs --size 10 --record frogs.log
+ * perf record ./driver --model frogs --size 10 --replay frogs.log
+ * ./driver --model frogs --size 10 --diff frogs.log
+ * A shortest trace is found keeping only the current path in memory, by iterative deepening:
+ * ./driver --model frogs --size 10 --order iddfs --nogoods 16384
+ * Depth-first search stops at the first goal, exploring the moves the model ranks best first:
+ * ./driver --model frogs --size 16 --order dfs --first-solution on --variant heuristic
+ * A search by cost may drop the nodes reached before as cheaply, reporting fewer traces:
+ * ./driver --model family --dominance on
+ */
+
+#include "driver.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <iterator>
+#include <stdexcept>
+#include <cstdio>
+#ifdef __linux__
+#include <sys/resource.h> // For peak memory
+#include <sys/wait.h> // For waitpid
+#include <unistd.h> // For fork
+#endif
+
+void usage(std::ostream &os) {
+    os << "Usage: driver [flags]\n"
+          "  --model NAME            model to run\n"
+          "  --size N                size of the puzzle, 0 for the model default\n"
+          "  --variant NAME          model specific variant\n"
+          "  --order bfs|dfs|sorted|iddfs\n"
+          "                          search order, ignored by models searching by cost, iddfs reports a shortest trace\n"
+          "  --max-depth N           largest depth bound of iddfs, 0 for none\n"
+          "  --nogoods N             entries of the table of states iddfs failed from, 0 for none\n"
+          "  --threads N             threads of a search (1), 0 for all, any number gives the same traces\n"
+          "  --pipeline G:F:H        pipelined breadth-first search with G generating, F filtering and H hashing\n"
+          "                          threads, F and H may be 0 to leave their work to the stage before\n"
+          "  --frontier-memory MB    frontier kept in memory before spilling to disk, 0 never spills\n"
+          "  --format text|binary|json|none\n"
+          "                          output format of the traces\n"
+          "  --output FILE           file of the traces instead of standard output\n"
+          "  --compare-threads N     checks that 1 to N threads write the same traces\n"
+          "  --queries N             runs N searches at once sharing the explored graph\n"
+          "  --dominance on|off      prunes dominated nodes from a search by cost\n"
+          "  --first-solution on|off stops depth-first search at the first goal\n"
+          "  --record FILE           records the exploration of the search to a log\n"
+          "  --diff FILE             compares the exploration with a recorded log\n"
+          "  --replay FILE           repeats the expansions of a recorded log instead of searching\n"
+          "  --batch FILE            runs the configurations of the lines of a file, - for standard input\n"
+          "  --jobs N                batch runs at once, each in its own process\n"
+          "Models:\n";
+    for (auto &model: models()) {
+        os << "  " << model.first << ": " << model.second.description << '\n';
+    }
+}
+
+std::size_t number(const std::string &flag, const std::string &value) {
+    std::size_t end = 0;
+    auto result = std::stoul(value, &end);
+    if (end != value.size())
+        throw std::invalid_argument("invalid number for " + flag + ": " + value);
+    return result;
+}
+
+// Applies the flags to a configuration, the batch and jobs flags are only accepted on the command line.
+void parse(const std::vector<std::string> &flags, run_config_t &config, std::string *batch, std::size_t *jobs) {
+    for (std::size_t i = 0; i < flags.size(); ++i) {
+        auto &flag = flags[i];
+        if (i + 1 == flags.size())
+            throw std::invalid_argument("missing value for " + flag);
+        auto &value = flags[++i];
+        if (flag == "--model") {
+            config.model = value;
+        } else if (flag == "--size") {
+            config.size = number(flag, value);
+        } else if (flag == "--variant") {
+            config.variant = value;
+        } else if (flag == "--order") {
+            if (value == "bfs")
+                config.order = search_order::breadth_first;
+            else if (value == "dfs")
+                config.order = search_order::depth_first;
+            else if (value == "sorted")
+                config.order = search_order::sorted_breadth_first;
+            else if (value == "iddfs")
+                config.order = search_order::iterative_deepening;
+            else
+                throw std::invalid_argument("unknown search order " + value);
+        } else if (flag == "--threads") {
+            config.threads = number(flag, value);
+        } else if (flag == "--pipeline") {
+            std::istringstream stages(value);
+            std::string stage;
+            for (auto &threads: config.pipeline) {
+                threads = std::getline(stages, stage, ':') ? number(flag, stage) : 0;
+            }
+            if (std::getline(stages, stage) || !config.pipeline[0])
+                throw std::invalid_argument("invalid pipeline " + value);
+        } else if (flag == "--max-depth") {
+            config.maxDepth = number(flag, value);
+        } else if (flag == "--nogoods") {
+            config.nogoods = number(flag, value);
+        } else if (flag == "--frontier-memory") {
+            config.frontierMemory = number(flag, value);
+        } else if (flag == "--format") {
+            if (value == "text")
+                config.format = output_format::text;
+            else if (value == "binary")
+                config.format = output_format::binary;
+            else if (value == "json")
+                config.format = output_format::json;
+            else if (value == "none")
+                config.format = output_format::none;
+            else
+                throw std::invalid_argument("unknown output format " + value);
+        } else if (flag == "--output") {
+            config.output = value;
+        } else if (flag == "--record") {
+            config.record = value;
+        } else if (flag == "--diff") {
+            config.diff = value;
+        } else if (flag == "--replay") {
+            config.replay = value;
+        } else if (flag == "--queries") {
+            config.queries = std::max<std::size_t>(1, number(flag, value));
+        } else if (flag == "--dominance") {
+            if (value != "on" && value != "off")
+                throw std::invalid_argument("invalid dominance " + value);
+            config.dominance = value == "on";
+        } else if (flag == "--first-solution") {
+            if (value != "on" && value != "off")
+                throw std::invalid_argument("invalid first solution " + value);
+            config.firstSolution = value == "on";
+        } else if (flag == "--compare-threads") {
+            config.compareThreads = number(flag, value);
+        } else if (flag == "--batch" && batch) {
+            *batch = value;
+        } else if (flag == "--jobs" && jobs) {
+            *jobs = std::max<std::size_t>(1, number(flag, value));
+        } else {
+            throw std::invalid_argument("unknown flag " + flag);
+        }
+    }
+}
+
+std::string describe(const run_config_t &config) {
+    static const char *orders[] = {"bfs", "dfs", "sorted", "iddfs"};
+    static const char *formats[] = {"text", "binary", "json", "none"};
+    std::ostringstream os;
+    os << config.model << " size=" << config.size;
+    if (!config.variant.empty())
+        os << " variant=" << config.variant;
+    os << " order=" << orders[static_cast<int>(config.order)] << " threads=" << config.threads
+       << " frontier-memory=" << config.frontierMemory << " format=" << formats[static_cast<int>(config.format)];
+    if (config.pipeline[0])
+        os << " pipeline=" << config.pipeline[0] << ':' << config.pipeline[1] << ':' << config.pipeline[2];
+    if (config.order == search_order::iterative_deepening)
+        os << " max-depth=" << config.maxDepth << " nogoods=" << config.nogoods;
+    if (config.firstSolution)
+        os << " first-solution=on";
+    if (config.dominance)
+        os << " dominance=on";
+    return os.str();
+}
+
+// Sets the engine policies of a configuration.
+void configure(const run_config_t &config) {
+    sorted_search_policy::threads = config.threads;
+    parallel_search_policy::threads = config.threads;
+    pipeline_search_policy::generators = config.pipeline[0];
+    pipeline_search_policy::filters = config.pipeline[1];
+    pipeline_search_policy::hashers = config.pipeline[2];
+    depth_first_policy::firstSolution = config.firstSolution;
+    deepening_search_policy::maxDepth = config.maxDepth;
+    deepening_search_policy::nogoods = config.nogoods;
+    // A block of the frontier holds 4096 nodes in about 4 KB.
+    spill_policy::memoryBlocks = config.frontierMemory * 256;
+}
+
+// Runs a configuration on 1 up to config.compareThreads threads and throws unless all write the same binary traces,
+// so a parallel search can be checked against the sequential one for regressions. The run on 1 thread is not
+// pipelined.
+void compareThreads(const run_config_t &config, const model_t &model) {
+    std::string expected;
+    for (std::size_t threads = 1; threads <= config.compareThreads; ++threads) {
+        auto threaded = config;
+        threaded.threads = threads;
+        threaded.format = output_format::binary;
+        if (threads == 1)
+            threaded.pipeline = {};
+        configure(threaded);
+        std::ostringstream os;
+        std::size_t traces;
+        {
+            trace_writer_t out(os);
+            traces = model.run(threaded, out);
+            out.binaryIndex();
+        }
+        if (threads == 1)
+            expected = os.str();
+        else if (os.str() != expected)
+            throw std::runtime_error(describe(threaded) + ": traces differ from those of 1 thread");
+        std::cerr << describe(threaded) << ": " << traces << " traces, same as 1 thread\n";
+    }
+}
+
+// Runs a configuration and reports its number of traces, time and peak memory on standard error.
+void run(const run_config_t &config) {
+    auto model = models().find(config.model);
+    if (model == models().end())
+        throw std::invalid_argument("unknown model " + config.model);
+    if (config.compareThreads) {
+        compareThreads(config, model->second);
+        return;
+    }
+    configure(config);
+
+    std::ofstream file;
+    if (!config.output.empty()) {
+        file.open(config.output, std::ios::binary);
+        if (!file)
+            throw std::runtime_error("cannot write " + config.output);
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::size_t traces;
+    {
+        trace_writer_t out(config.output.empty() ? std::cout : file);
+        traces = model->second.run(config, out);
+        if (config.format == output_format::binary)
+            out.binaryIndex();
+    }
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << describe(config) << ": " << traces << " traces, " << seconds << " s";
+#ifdef __linux__
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    std::cerr << ", peak " << usage.ru_maxrss / 1024 << " MB";
+#endif
+    std::cerr << '\n';
+}
+
+#ifdef __linux__
+// Runs every configuration in a forked process, so the runs neither share memory nor the engine policies and the
+// peak memory is their own. The traces of runs to standard output are kept in temporary files and copied out in the
+// order of the configurations.
+int runForked(const std::vector<run_config_t> &configs, std::size_t jobs) {
+    struct job_t {
+        pid_t pid = -1;
+        std::FILE *output = nullptr;
+        bool done = false;
+    };
+    std::vector<job_t> started(configs.size());
+    std::size_t next = 0, running = 0, printed = 0;
+    auto failures = 0;
+    auto finish = [&](pid_t pid, int status) {
+        for (auto &job: started) {
+            if (job.pid == pid)
+                job.done = true;
+        }
+        --running;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            ++failures;
+        for (; printed < next && started[printed].done; ++printed) {
+            if (auto output = started[printed].output) {
+                std::rewind(output);
+                char buffer[1 << 16];
+                for (std::size_t size; (size = std::fread(buffer, 1, sizeof(buffer), output)) > 0;)
+                    std::cout.write(buffer, static_cast<std::streamsize>(size));
+                std::fclose(output);
+            }
+        }
+        std::cout.flush();
+    };
+    std::cout.flush();
+    while (printed < configs.size()) {
+        if (next < configs.size() && running < jobs) {
+            auto &job = started[next];
+            if (configs[next].output.empty() && !(job.output = std::tmpfile()))
+                throw std::runtime_error("cannot create a temporary file");
+            job.pid = ::fork();
+            if (job.pid < 0)
+                throw std::runtime_error("cannot fork");
+            if (job.pid == 0) {
+                if (job.output)
+                    ::dup2(fileno(job.output), STDOUT_FILENO);
+                auto code = 0;
+                try {
+                    run(configs[next]);
+                } catch (const std::exception &error) {
+                    std::cerr << describe(configs[next]) << ": " << error.what() << '\n';
+                    code = 1;
+                }
+                std::cout.flush();
+                std::cerr.flush();
+                ::_exit(code);
+            }
+            ++next;
+            ++running;
+            continue;
+        }
+        int status = 0;
+        auto pid = ::waitpid(-1, &status, 0);
+        if (pid > 0)
+            finish(pid, status);
+    }
+    return failures ? 1 : 0;
+}
+#endif
+
+int main(int argc, char *argv[]) {
+    run_config_t defaults;
+    std::string batch;
+    std::size_t jobs = 1;
+    try {
+        std::vector<std::string> flags(argv + 1, argv + argc);
+        if (flags.empty() || flags[0] == "--help") {
+            usage(flags.empty() ? std::cerr : std::cout);
+            return flags.empty() ? 1 : 0;
+        }
+        parse(flags, defaults, &batch, &jobs);
+
+        std::vector<run_config_t> configs;
+        if (batch.empty()) {
+            configs.push_back(defaults);
+        } else {
+            std::ifstream file;
+            if (batch != "-") {
+                file.open(batch);
+                if (!file)
+                    throw std::runtime_error("cannot read " + batch);
+            }
+            std::istream &lines = batch == "-" ? std::cin : file;
+            for (std::string line; std::getline(lines, line);) {
+                std::istringstream words(line.substr(0, line.find('#')));
+                std::vector<std::string> lineFlags{std::istream_iterator<std::string>(words), {}};
+                if (lineFlags.empty())
+                    continue;
+                configs.push_back(defaults);
+                parse(lineFlags, configs.back(), nullptr, nullptr);
+            }
+        }
+#ifdef __linux__
+        if (jobs > 1)
+            return runForked(configs, jobs);
+#endif
+        for (auto &config: configs) {
+            run(config);
+        }
+    } catch (const std::exception &error) {
+        std::cerr << error.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
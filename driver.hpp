@@ -0,0 +1,186 @@
+/**
+ * Registry of the puzzle models run by the command-line driver, see driver.cpp.
+ * A model compiled with PUZZLE_DRIVER registers a run function under its name. The function solves the model for a
+ * configuration and reports the traces to a writer in the configured format.
+ */
+
+#ifndef PUZZLEENGINE_DRIVER_HPP
+#define PUZZLEENGINE_DRIVER_HPP
+
+#include "reachability.hpp"
+
+#include <array> // For pipeline stages
+#include <functional> // For function
+#include <fstream> // For search logs
+#include <iostream> // For cerr
+#include <stdexcept> // For runtime_error
+#include <thread> // For concurrent queries
+#include <vector> // For concurrent queries
+#include <map> // For the model registry
+#include <string> // For names
+
+enum class output_format {
+    text, binary, json, none
+};
+
+// A configuration of a model run as given on the command line.
+struct run_config_t {
+    std::string model;
+    // Size of the puzzle, such as the frogs on each side, 0 for the default of the model.
+    std::size_t size = 0;
+    // Model specific variant, such as the cost function of the family puzzle, empty for the default.
+    std::string variant;
+    search_order order = search_order::breadth_first;
+    // Threads of a search, 0 uses all hardware threads, see parallel_search_policy. One by default, as the engine, since
+    // more threads call the transition, invariant and cost functions of the model concurrently.
+    std::size_t threads = 1;
+    // Threads of the generating, filtering and hashing stages of a pipelined search, see pipeline_search_policy.
+    std::array<std::size_t, 3> pipeline{};
+    // Megabytes of frontier blocks kept in memory before spilling, 0 never spills, see spill_policy.
+    std::size_t frontierMemory = 0;
+    // Largest depth bound and nogood table entries of iterative deepening, see deepening_search_policy.
+    std::size_t maxDepth = 0;
+    std::size_t nogoods = deepening_search_policy::nogoods;
+    output_format format = output_format::text;
+    // File written with the traces, standard output when empty.
+    std::string output;
+    // Search log files, see search_log_t: record writes the log of the search, diff compares it with a recorded log
+    // and replay repeats a recorded search instead of searching.
+    std::string record;
+    std::string diff;
+    std::string replay;
+    // Runs this many searches on one space at once, see state_space_t::shareGraph. The traces of the first are written
+    // and the others must find as many.
+    std::size_t queries = 1;
+    // Runs the search on 1 up to this many threads and checks that all write the same traces instead, 0 runs once.
+    std::size_t compareThreads = 0;
+    // Stops depth-first search at the first goal, see depth_first_policy.
+    bool firstSolution = false;
+    // Prunes dominated nodes from a search by cost, see state_space_t::dominance. Models without a dominance ignore it.
+    bool dominance = false;
+};
+
+// Runs a model for a configuration and returns the number of traces found.
+using model_run_t = std::function<std::size_t(const run_config_t &, trace_writer_t &)>;
+
+struct model_t {
+    std::string description;
+    model_run_t run;
+};
+
+inline std::map<std::string, model_t> &models() {
+    static std::map<std::string, model_t> registry;
+    return registry;
+}
+
+// Registers a model when a static instance in the translation unit of the model is initialised.
+struct model_registration_t {
+    model_registration_t(const std::string &name, const std::string &description, model_run_t run) {
+        models()[name] = model_t{description, std::move(run)};
+    }
+};
+
+// Runs a model's search for a configuration and returns the number of traces, or the number of goals of a replay.
+// Recording, comparing with and replaying a search log are done here, so every model supports them.
+template<class SpaceT, class ValidationF, class ReportF>
+std::size_t search(const run_config_t &config, SpaceT &space, ValidationF isGoalState, ReportF &&report) {
+    auto load = [](const std::string &path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            throw std::runtime_error("cannot read " + path);
+        return search_log_t::load(file);
+    };
+    if (!config.replay.empty()) {
+        auto log = load(config.replay);
+        auto replayed = space.replay(isGoalState, log);
+        if (replayed.divergence != search_log_t::no_event)
+            throw std::runtime_error("replay diverges at event " + std::to_string(replayed.divergence) + ": " +
+                                     replayed.expected + " was recorded, " + replayed.found + " found");
+        return replayed.goals;
+    }
+    if (config.queries > 1) {
+        space.shareGraph();
+        std::vector<std::size_t> found(config.queries - 1);
+        std::vector<std::thread> queries;
+        for (auto &count: found) {
+            queries.emplace_back([&space, &isGoalState, &config, &count] {
+                count = space.check(isGoalState, [](auto &&) {}, config.order);
+            });
+        }
+        auto traces = space.check(isGoalState, report, config.order);
+        for (auto &query: queries) {
+            query.join();
+        }
+        for (auto count: found) {
+            if (count != traces)
+                throw std::runtime_error("a concurrent query found " + std::to_string(count) + " traces instead of " +
+                                         std::to_string(traces));
+        }
+        auto filtered = space.sharedGraph()->filterStatistics();
+        std::cerr << config.queries << " queries shared a graph of " << space.sharedGraph()->size() << " states, "
+                  << filtered.hits << " of " << filtered.lookups << " interned successors were found by the filters "
+                  << "of the threads\n";
+        return traces;
+    }
+    search_log_t log;
+    if (!config.record.empty() || !config.diff.empty())
+        space.record(&log);
+    auto traces = space.check(isGoalState, report, config.order);
+    space.record(nullptr);
+    auto filtered = space.filterStatistics();
+    if (filtered.lookups > 0)
+        std::cerr << filtered.hits << " of " << filtered.lookups << " successors were found by the filters of the "
+                  << "workers\n";
+    if (!config.record.empty()) {
+        std::ofstream file(config.record, std::ios::binary);
+        log.save(file);
+        if (!file)
+            throw std::runtime_error("cannot write " + config.record);
+    }
+    if (!config.diff.empty()) {
+        auto recorded = load(config.diff);
+        auto summarize = [](const search_log_t &log) {
+            auto &summary = log.summary();
+            return std::to_string(summary.pops) + " pops, " + std::to_string(summary.goals) + " goals, " +
+                   std::to_string(summary.expansions) + " expansions, " + std::to_string(summary.newStates) +
+                   " new states, " + std::to_string(summary.duplicates) + " duplicates";
+        };
+        std::cerr << "recorded: " << summarize(recorded) << "\nthis run: " << summarize(log) << '\n';
+        auto difference = search_log_t::diff(recorded, log);
+        if (difference.event == search_log_t::no_event)
+            std::cerr << "the searches are the same\n";
+        else
+            std::cerr << "the searches differ from event " << difference.event << ": " << difference.first
+                      << " was recorded, " << difference.second << " in this run\n";
+    }
+    return traces;
+}
+
+// Writes a trace in the configured format. Text states are formatted by format(writer, state), JSON states by
+// json(writer, state), which defaults to trace_writer_t::json.
+template<class TraceT, class FormatF, class JsonF>
+void write_trace(const run_config_t &config, trace_writer_t &out, const TraceT &trace, FormatF &&format,
+                 JsonF &&json) {
+    switch (config.format) {
+        case output_format::text:
+            out << "Solution: trace of " << trace.size() << " states\n";
+            out.trace(trace, format);
+            out << '\n';
+            break;
+        case output_format::binary:
+            out.binaryTrace(trace);
+            break;
+        case output_format::json:
+            out.jsonTrace(trace, json);
+            break;
+        case output_format::none:
+            break;
+    }
+}
+
+template<class TraceT, class FormatF>
+void write_trace(const run_config_t &config, trace_writer_t &out, const TraceT &trace, FormatF &&format) {
+    write_trace(config, out, trace, format, [](trace_writer_t &writer, const auto &state) { writer.json(state); });
+}
+
+#endif //PUZZLEENGINE_DRIVER_HPP
@@ -13,6 +13,29 @@
  * List:                                                    156532644 ns (108448079 ns)
  * Priority queue instead of sorted list for waiting:       143821806 ns (104294183 ns)
  * With smart pointers:                                     225769872 ns (50065230 ns)
+ *
+ * Hashing and comparing one state_t (40 bytes):
+ * Byte-wise state_hash:                                    15.5 ns
+ * Packed, automatic:                                        2.4 ns
+ * Packed, wyhash:                                           2.5 ns
+ * Packed, SSE4.2 CRC32:                                     6.0 ns
+ * Packed, AVX2:                                            24.5 ns
+ * operator==:                                               1.3 ns
+ * Packed equality, automatic (memcmp):                      2.0 ns
+ * Packed equality, AVX2:                                    7.5 ns
+ *
+ * The hand-written model and the model compiled from river_rules_t (family_rules):
+ * Solving with the depth cost, hand-written:              651 us
+ * Solving with the depth cost, river rules:               411 us
+ * Solving with the depth cost, hand-written, dominance:   555 us
+ * Solving for the three costs one after the other:       2100 us
+ * Solving for the three costs by one Pareto search:       824 us
+ * Successors of one state with their checks, hand-written: 241 ns
+ * Successors of one state with their checks, river rules:   68 ns
+ * Dominance drops the nodes of states reached before as cheaply on generation, so the depth search pops 614 instead
+ * of 1821 nodes and reports only the first of the 7 traces. The Pareto search reports the two solutions taking either
+ * son first in 62 steps, which are also the solutions of the noise costs, and drops the noisier shortest solution
+ * the depth cost finds first.
  */
 
 #include "reachability.hpp" // your header-only library solution
@@ -21,12 +44,20 @@
 #include <deque>
 #include <array>
 #include <functional> // std::function
+#include <tuple> // std::tie
 
 // Enable or disable benchmarking.
 // #define ENABLE_BENCHMARKING
+// Enable to solve on a cluster of 4 processes on this machine, see cluster_t.
+// #define ENABLE_DISTRIBUTED
 #ifdef ENABLE_BENCHMARKING
 #include <benchmark/benchmark.h>
 #endif
+// Defined when linked into the command-line driver, see driver.cpp.
+#ifdef PUZZLE_DRIVER
+#include "driver.hpp"
+#include <sstream>
+#endif
 
 /** Model of the river crossing: persons and a boat */
 struct person_t {
@@ -53,6 +84,11 @@ struct state_t {
     std::array<person_t, 8> persons;
 };
 
+// States are plain structs without padding, so the state pool hashes and compares them with the packed kernels.
+template<>
+struct state_hash<state_t> : packed_hash<state_t> {
+};
+
 // Compare two people based on their position
 bool operator==(const person_t &p1, const person_t &p2) {
     return (p1.pos == p2.pos);
@@ -117,14 +153,18 @@ std::ostream &operator<<(std::ostream &os, const state_t &state) {
               << state.persons[person_t::prisoner];
 }
 
+// Disable to keep the reasons of invalid states out of the output.
+bool logging = true;
+
 void log(const std::string &input) {
-    std::cout << input << std::endl;
+    if (logging)
+        std::cout << input << std::endl;
 }
 
 /** Returns a list of transitions applicable on a given state.
  * Transition is a function modifying a state */
 auto transitions(const state_t &s) {
-    auto res = std::deque<std::function<void(state_t &)>>{};
+    auto res = transitions_t<state_t>{};
     switch (s.boat.pos) {
         case boat_t::shore1:
         case boat_t::shore2:
@@ -281,13 +321,104 @@ bool operator>(const cost_t a, cost_t b) {
 
 void successors(std::deque<std::function<void(state_t &)>> (*transitions)(const state_t &));
 
+// Costs preferring the shortest solutions and, at equal lengths through the depth, the solutions taking the noisiest
+// son to shore2 first.
+cost_t depth_cost(const state_t &state, const cost_t &prev_cost) {
+    return cost_t{prev_cost.depth + 1, prev_cost.noise};
+}
+
+cost_t older_son_noise(const state_t &state, const cost_t &prev_cost) {
+    auto noise = prev_cost.noise;
+    if (state.persons[person_t::son1].pos == person_t::shore1)
+        noise += 2; // older son is more noughty, prefer him first
+    if (state.persons[person_t::son2].pos == person_t::shore1)
+        noise += 1;
+    return cost_t{prev_cost.depth, noise};
+}
+
+cost_t younger_son_noise(const state_t &state, const cost_t &prev_cost) {
+    auto noise = prev_cost.noise;
+    if (state.persons[person_t::son1].pos == person_t::shore1)
+        noise += 1;
+    if (state.persons[person_t::son2].pos == person_t::shore1)
+        noise += 2; // younger son is more distressed, prefer him first
+    return cost_t{prev_cost.depth, noise};
+}
+
+// The three costs above at once, as the objectives of a Pareto search: a single search finds the shortest solution,
+// the solution quietest for each son and any solution trading length for quiet in between.
+struct costs_t {
+    size_t depth{0};
+    size_t older_noise{0};
+    size_t younger_noise{0};
+    // Orders as cost_t, the highest first.
+    bool operator<(const costs_t &other) const {
+        return std::tie(other.depth, other.older_noise, other.younger_noise) <
+               std::tie(depth, older_noise, younger_noise);
+    }
+};
+
+costs_t all_costs(const state_t &state, const costs_t &prev_costs) {
+    return costs_t{depth_cost(state, cost_t{prev_costs.depth, 0}).depth,
+                   older_son_noise(state, cost_t{0, prev_costs.older_noise}).noise,
+                   younger_son_noise(state, cost_t{0, prev_costs.younger_noise}).noise};
+}
+
+std::array<size_t, 3> objectives(const state_t &, const costs_t &costs) {
+    return {costs.depth, costs.older_noise, costs.younger_noise};
+}
+
 bool goal(const state_t &s) {
     return std::all_of(std::begin(s.persons), std::end(s.persons),
                        [](const person_t &p) { return p.pos == person_t::shore2; });
 }
 
-template<typename CostFn>
-void solve(CostFn &&cost) { // no type checking: OK hack here, but not good for library.
+// The dominance of the family searches: the positions key a state exactly, so a node dominates the later nodes of its
+// state which are neither shorter nor quieter.
+std::uint64_t family_key(const state_t &state) {
+    std::uint64_t key = state.boat.pos | static_cast<std::uint64_t>(state.boat.passengers) << 2;
+    for (auto i = 0u; i < state.persons.size(); ++i)
+        key |= static_cast<std::uint64_t>(state.persons[i].pos) << (8 + 2 * i);
+    return key;
+}
+
+std::array<size_t, 2> family_fields(const state_t &, const cost_t &cost) {
+    return {cost.depth, cost.noise};
+}
+
+// The same puzzle declared as river crossing rules instead of the transitions and river_crossing_valid above. The
+// actors are added in the order of the persons, so an actor index is a person index. The prisoner is only checked
+// while the boat crosses, as river_crossing_valid does.
+river_model_t family_rules() {
+    auto rules = river_rules_t{2};
+    for (auto name: {"mother", "father", "daughter1", "daughter2", "son1", "son2", "policeman", "prisoner"})
+        rules.actor(name);
+    rules.rowers({person_t::mother, person_t::father, person_t::policeman})
+            .forbid({person_t::daughter1, person_t::daughter2}, {person_t::father}, {person_t::mother})
+            .forbid({person_t::son1, person_t::son2}, {person_t::mother}, {person_t::father})
+            .forbid({person_t::prisoner},
+                    {person_t::mother, person_t::father, person_t::daughter1, person_t::daughter2, person_t::son1,
+                     person_t::son2}, {person_t::policeman}, river_check::crossing);
+    return rules.compile();
+}
+
+// A state of the compiled rules as a state_t, for the cost functions and printing.
+state_t family_state(const river_model_t &model, const river_state_t &rules_state) {
+    auto state = state_t{};
+    state.boat.pos = rules_state.boat == river_place::shore1 ? boat_t::shore1 :
+                     rules_state.boat == river_place::boat ? boat_t::travel : boat_t::shore2;
+    state.boat.passengers = static_cast<uint16_t>(model.passengers(rules_state));
+    for (auto i = 0u; i < state.persons.size(); ++i) {
+        auto place = model.place(rules_state, i);
+        state.persons[i].pos = place == river_place::shore1 ? person_t::shore1 :
+                               place == river_place::boat ? person_t::onboard : person_t::shore2;
+    }
+    return state;
+}
+
+// The optional cluster solves on several processes, see cluster_t, of which only rank 0 reports.
+template<typename CostFn, typename... ClusterT>
+void solve(CostFn &&cost, ClusterT &... cluster) { // no type checking: OK hack here, but not good for library.
     // Overall there are 4*3*2*1/2 solutions to the puzzle
     // (children form 2 symmetric groups and thus result in 2 out of 4 permutations).
     // However the search algorithm may collapse symmetric solutions, thus only one is reported.
@@ -296,10 +427,12 @@ void solve(CostFn &&cost) { // no type checking: OK hack here, but not good for
     auto states = state_space_t{
             state_t{}, // initial state
             cost_t{},   // initial cost
-            successors<state_t>(transitions), // successor generator from your library
+            successors<state_t, std::deque>(transitions), // successor generator from your library
             &river_crossing_valid,            // invariant over states
             std::forward<CostFn>(cost)};      // cost over states
-    auto solutions = states.check(&goal);
+    auto solutions = states.check(&goal, cluster...);
+    if ((... || (cluster.rank() != 0)))
+        return;
     if (solutions.empty()) {
         std::cout << "No solution\n";
     } else {
@@ -312,32 +445,136 @@ void solve(CostFn &&cost) { // no type checking: OK hack here, but not good for
     }
 }
 
-#ifndef ENABLE_BENCHMARKING
+// Reports the Pareto-optimal solutions for depth and the noise of either son, see costs_t, instead of solving for each
+// cost separately.
+void solve_pareto() {
+    auto states = state_space_t{state_t{}, costs_t{}, successors<state_t, std::deque>(transitions),
+                                &river_crossing_valid, &all_costs};
+    states.pareto(&objectives);
+    auto solutions = states.check(&goal);
+    if (solutions.empty()) {
+        std::cout << "No solution\n";
+        return;
+    }
+    for (auto &&trace: solutions) {
+        auto costs = costs_t{};
+        for (auto it = std::next(trace.begin()); it != trace.end(); ++it)
+            costs = all_costs(*it, costs);
+        std::cout << "Solution of depth " << costs.depth << ", older son noise " << costs.older_noise
+                  << ", younger son noise " << costs.younger_noise << ":\n";
+        std::cout << "Boat,     Mothr,Fathr,Daug1,Daug2,Son1, Son2, Polic,Prisn\n";
+        for (auto &&state: trace)
+            std::cout << state << '\n';
+    }
+}
+
+#ifdef PUZZLE_DRIVER
+// Formats a trace state for trace_writer_t through the stream operators above.
+void format(trace_writer_t &out, const state_t &state) {
+    std::ostringstream os;
+    os << state;
+    out << os.str();
+}
+
+// Formats a state as a JSON array of the boat position, passengers and capacity followed by the person positions.
+void json(trace_writer_t &out, const state_t &state) {
+    out << '[' << static_cast<int>(state.boat.pos) << ',' << state.boat.passengers << ',' << state.boat.capacity;
+    for (auto &person: state.persons)
+        out << ',' << static_cast<int>(person.pos);
+    out << ']';
+}
+
+// The cost of a variant of the driver models: depth (the default), older-son-noise or younger-son-noise.
+auto cost_for(const std::string &variant) -> cost_t (*)(const state_t &, const cost_t &) {
+    if (variant.empty() || variant == "depth")
+        return &depth_cost;
+    if (variant == "older-son-noise")
+        return &older_son_noise;
+    if (variant == "younger-son-noise")
+        return &younger_son_noise;
+    throw std::invalid_argument("unknown family cost " + variant);
+}
+
+// The variant is the cost: depth (the default), older-son-noise, younger-son-noise or pareto, which reports the
+// Pareto-optimal solutions for all three, see solve_pareto.
+static model_registration_t family_model{
+        "family", "Japanese family river crossing, the variant is the cost: depth, older-son-noise, "
+                  "younger-son-noise or pareto for all three",
+        [](const run_config_t &config, trace_writer_t &out) {
+            logging = false;
+            if (config.variant == "pareto") {
+                auto states = state_space_t{state_t{}, costs_t{}, successors<state_t, std::deque>(transitions),
+                                            &river_crossing_valid, &all_costs};
+                states.pareto(&objectives);
+                return search(config, states, &goal,
+                              [&](std::deque<state_t> &&trace) { write_trace(config, out, trace, format, json); });
+            }
+            auto cost = cost_for(config.variant);
+            auto states = state_space_t{state_t{}, cost_t{}, successors<state_t, std::deque>(transitions),
+                                        &river_crossing_valid, cost};
+            if (config.dominance)
+                states.dominance(&family_key, &family_fields);
+            return search(config, states, &goal,
+                          [&](std::deque<state_t> &&trace) { write_trace(config, out, trace, format, json); });
+        }};
+
+// The family puzzle compiled from river_rules_t, it writes the same traces as the family model.
+static model_registration_t family_rules_model{
+        "family-rules", "Japanese family river crossing declared as river crossing rules, the variants are those of "
+                        "family",
+        [](const run_config_t &config, trace_writer_t &out) {
+            auto model = family_rules();
+            auto crossed = [&model](const river_state_t &state) { return model.crossed(state); };
+            auto report = [&](std::vector<river_state_t> &&trace) {
+                std::vector<state_t> persons;
+                for (auto &state: trace)
+                    persons.push_back(family_state(model, state));
+                write_trace(config, out, persons, format, json);
+            };
+            if (config.variant == "pareto") {
+                auto states = state_space_t{model.initial(), costs_t{}, model.successors(), model.invariant(),
+                                            [&model](const river_state_t &state, const costs_t &prev_costs) {
+                                                return all_costs(family_state(model, state), prev_costs);
+                                            }};
+                states.pareto([&model](const river_state_t &state, const costs_t &costs) {
+                    return objectives(family_state(model, state), costs);
+                });
+                return search(config, states, crossed, report);
+            }
+            auto cost = cost_for(config.variant);
+            auto states = state_space_t{model.initial(), cost_t{}, model.successors(), model.invariant(),
+                                        [&model, cost](const river_state_t &state, const cost_t &prev_cost) {
+                                            return cost(family_state(model, state), prev_cost);
+                                        }};
+            if (config.dominance)
+                states.dominance(
+                        [actors = model.actors()](const river_state_t &state) {
+                            return state.onboard | static_cast<std::uint64_t>(state.across) << actors |
+                                   static_cast<std::uint64_t>(state.boat) << 2 * actors;
+                        },
+                        [](const river_state_t &, const cost_t &cost) {
+                            return std::array<size_t, 2>{cost.depth, cost.noise};
+                        });
+            return search(config, states, crossed, report);
+        }};
+#endif
+
+#if !defined(ENABLE_BENCHMARKING) && !defined(PUZZLE_DRIVER)
+#ifdef ENABLE_DISTRIBUTED
+int main() {
+    auto cluster = cluster_t::loopback(4); // 4 processes on this machine
+    if (cluster.rank() == 0)
+        std::cout << "-- Solve using depth as a cost on " << cluster.size() << " processes: ---\n";
+    solve(depth_cost, cluster);
+}
+#else
 int main() {
-    std::cout << "-- Solve using depth as a cost: ---\n";
-    solve([](const state_t &state, const cost_t &prev_cost) {
-        return cost_t{prev_cost.depth + 1, prev_cost.noise};
-    }); // it is likely that daughters will get to shore2 first
-    std::cout << "-- Solve using noise as a cost: ---\n";
-    solve([](const state_t &state, const cost_t &prev_cost) {
-        auto noise = prev_cost.noise;
-        if (state.persons[person_t::son1].pos == person_t::shore1)
-            noise += 2; // older son is more noughty, prefer him first
-        if (state.persons[person_t::son2].pos == person_t::shore1)
-            noise += 1;
-        return cost_t{prev_cost.depth, noise};
-    }); // son1 should get to shore2 first
-    std::cout << "-- Solve using different noise as a cost: ---\n";
-    solve([](const state_t &state, const cost_t &prev_cost) {
-        auto noise = prev_cost.noise;
-        if (state.persons[person_t::son1].pos == person_t::shore1)
-            noise += 1;
-        if (state.persons[person_t::son2].pos == person_t::shore1)
-            noise += 2; // younger son is more distressed, prefer him first
-        return cost_t{prev_cost.depth, noise};
-    }); // son2 should get to the shore2 first
+    // The shortest solution likely takes the daughters to shore2 first, the quietest ones son1 or son2.
+    std::cout << "-- Solve for depth and the noise of either son at once: ---\n";
+    solve_pareto();
 }
 #endif
+#endif
 
 #ifdef ENABLE_BENCHMARKING
 // Enable for benchmarking
@@ -369,5 +606,140 @@ void BM_main(benchmark::State& state){
 }
 
 BENCHMARK(BM_main)->Iterations(100);
+
+// Hashing and comparing a state with the byte-wise default hash and the packed kernels.
+void BM_hash_bytes(benchmark::State &state) {
+    auto s = state_t{};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(reachability_detail::hash_bytes(&s, sizeof(s)));
+    }
+}
+
+template<hash_kernel Kernel>
+void BM_hash(benchmark::State &state) {
+    auto s = state_t{};
+    auto hash = packed_hash<state_t, Kernel>{};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(hash(s));
+    }
+}
+
+void BM_equal_operator(benchmark::State &state) {
+    auto s = state_t{};
+    auto other = s;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(s == other);
+    }
+}
+
+template<hash_kernel Kernel>
+void BM_equal(benchmark::State &state) {
+    auto s = state_t{};
+    auto other = s;
+    auto hash = packed_hash<state_t, Kernel>{};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(hash.equal(s, other));
+    }
+}
+
+BENCHMARK(BM_hash_bytes);
+BENCHMARK_TEMPLATE(BM_hash, hash_kernel::automatic);
+BENCHMARK_TEMPLATE(BM_hash, hash_kernel::wyhash);
+BENCHMARK_TEMPLATE(BM_hash, hash_kernel::crc32);
+BENCHMARK_TEMPLATE(BM_hash, hash_kernel::avx2);
+BENCHMARK(BM_equal_operator);
+BENCHMARK_TEMPLATE(BM_equal, hash_kernel::automatic);
+BENCHMARK_TEMPLATE(BM_equal, hash_kernel::avx2);
+
+// Solving with the depth cost, with the hand-written model and with the model compiled from river_rules_t.
+void BM_solve_handwritten(benchmark::State &state) {
+    logging = false;
+    for (auto _ : state) {
+        auto states = state_space_t{state_t{}, cost_t{}, successors<state_t, std::deque>(transitions),
+                                    &river_crossing_valid, &depth_cost};
+        benchmark::DoNotOptimize(states.check(&goal));
+    }
+}
+
+void BM_solve_rules(benchmark::State &state) {
+    auto model = family_rules();
+    for (auto _ : state) {
+        auto states = state_space_t{model.initial(), cost_t{}, model.successors(), model.invariant(),
+                                    [&model](const river_state_t &s, const cost_t &prev_cost) {
+                                        return depth_cost(family_state(model, s), prev_cost);
+                                    }};
+        benchmark::DoNotOptimize(states.check([&model](const river_state_t &s) { return model.crossed(s); }));
+    }
+}
+
+// Solving with the depth cost, pruning the nodes dominated by a shorter or quieter node of their state.
+void BM_solve_dominance(benchmark::State &state) {
+    logging = false;
+    for (auto _ : state) {
+        auto states = state_space_t{state_t{}, cost_t{}, successors<state_t, std::deque>(transitions),
+                                    &river_crossing_valid, &depth_cost};
+        states.dominance(&family_key, &family_fields);
+        benchmark::DoNotOptimize(states.check(&goal));
+    }
+}
+
+// Solving for the three costs one after the other, and for all of them at once by a Pareto search.
+void BM_solve_costs(benchmark::State &state) {
+    logging = false;
+    for (auto _ : state) {
+        for (auto cost: {&depth_cost, &older_son_noise, &younger_son_noise}) {
+            auto states = state_space_t{state_t{}, cost_t{}, successors<state_t, std::deque>(transitions),
+                                        &river_crossing_valid, cost};
+            benchmark::DoNotOptimize(states.check(&goal));
+        }
+    }
+}
+
+void BM_solve_pareto(benchmark::State &state) {
+    logging = false;
+    for (auto _ : state) {
+        auto states = state_space_t{state_t{}, costs_t{}, successors<state_t, std::deque>(transitions),
+                                    &river_crossing_valid, &all_costs};
+        states.pareto(&objectives);
+        benchmark::DoNotOptimize(states.check(&goal));
+    }
+}
+
+// Generating the successors of a state with the boat on shore1 and both parents on board, and checking them.
+void BM_successors_handwritten(benchmark::State &state) {
+    logging = false;
+    auto s = state_t{};
+    s.persons[person_t::mother].pos = person_t::onboard;
+    s.persons[person_t::father].pos = person_t::onboard;
+    s.boat.passengers = 2;
+    for (auto _ : state) {
+        for (auto &transition: transitions(s)) {
+            auto successor = s;
+            transition(successor);
+            benchmark::DoNotOptimize(river_crossing_valid(successor));
+        }
+    }
+}
+
+void BM_successors_rules(benchmark::State &state) {
+    auto model = family_rules();
+    auto s = river_state_t{};
+    s.onboard = 1u << person_t::mother | 1u << person_t::father;
+    for (auto _ : state) {
+        for (auto &transition: model.transitions(s)) {
+            auto successor = s;
+            transition(successor);
+            benchmark::DoNotOptimize(model.valid(successor));
+        }
+    }
+}
+
+BENCHMARK(BM_solve_handwritten)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_solve_rules)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_solve_dominance)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_solve_costs)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_solve_pareto)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_successors_handwritten);
+BENCHMARK(BM_successors_rules);
 BENCHMARK_MAIN();
 #endif
@@ -11,6 +11,74 @@
  * List:                                  1920407 ns (543956 ns)
  * Deque:                                 2659367 ns (504552 ns)
  * With smart pointers (shared):          2189727 ns (524632 ns)
+ *
+ * Hashing and comparing stones of 4 / 20 / 511 frogs (36 / 164 / 4096 bytes):
+ * Element-wise state_hash:                 43 ns /  298 ns / 8626 ns
+ * Packed, automatic:                        5 ns /   18 ns /  271 ns
+ * Packed, wyhash:                           6 ns /   19 ns /  661 ns
+ * Packed, SSE4.2 CRC32:                    16 ns /   21 ns /  328 ns
+ * Packed, AVX2:                            23 ns /   28 ns /  256 ns
+ * operator==:                               9 ns /   35 ns /  850 ns
+ * Packed equality, automatic (memcmp):      5 ns /    7 ns /   88 ns
+ * Packed equality, AVX2:                    9 ns /   15 ns /  123 ns
+ *
+ * Probing a state pool of 4K / 64K / 1M / 16M boards with blocks of 64 boards (the 16M pool exceeds the LLC):
+ * One by one:                            1850 ns / 2543 ns / 7498 ns / 11881 ns
+ * Batched with prefetching:              2204 ns / 2547 ns / 4136 ns /  7478 ns
+ *
+ * Probing 1M / 16M boards with the pool tables on 4 KB pages (MADV_NOHUGEPAGE) and transparent huge pages:
+ * One by one, 4 KB pages:                4943 ns / 9218 ns
+ * One by one, huge pages:                5083 ns / 7724 ns
+ * Batched, 4 KB pages:                   3243 ns / 5719 ns
+ * Batched, huge pages:                   2635 ns / 4742 ns
+ * The parallel searches also pin their workers to the NUMA nodes, with the successor buffers of each worker on its
+ * node and the pool and trace tables on the node of the interning thread. This machine has a single node, where
+ * nothing is pinned, so that placement is not measured here.
+ *
+ * Solving 16 / 18 frogs on a cluster of loopback processes (ENABLE_DISTRIBUTED) on a single core, peak memory of
+ * the largest process:
+ * Sequential check:                      0.70 s  306 MB /  3.43 s 1314 MB
+ * 1 process:                             0.64 s  312 MB
+ * 2 processes:                           0.70 s  159 MB
+ * 4 processes:                           0.81 s   83 MB /  3.54 s  339 MB
+ *
+ * Solving 14 / 18 frogs breadth-first on a single core, with the state pool and with sorted layers:
+ * State pool:                              99 ms /  73 MB    3585 ms / 1314 MB
+ * Sorted layers, checking all layers:     119 ms /  59 MB    2736 ms / 1188 MB
+ * Sorted layers, checking 2 layers:        70 ms /  49 MB    1576 ms /  949 MB
+ * With the waiting list in delta-coded blocks and the sorted layers bit-packed in blocks of 256 states:
+ * State pool:                             100 ms /  73 MB    2953 ms / 1313 MB
+ * Sorted layers, checking all layers:     145 ms /  22 MB    2875 ms /  358 MB
+ * Sorted layers, checking 2 layers:       102 ms /   9 MB    1881 ms /  117 MB
+ *
+ * Finding the first solution for 12 / 16 frogs depth-first, the history learning from the searches before:
+ * Moves as generated:                      10 ms /  317 ms
+ * Ordered by same_neighbours:               3 ms /   67 ms
+ * Ordered by the history of move_kind:      6 ms /  262 ms
+ *
+ * Solving 8 / 10 frogs by iterative deepening, which keeps only the current path:
+ * Without nogoods:                         53 ms /  321 ms
+ * With a nogood table of 16K states:       10 ms /   51 ms
+ *
+ * Cycling 1G nodes through a breadth-first frontier of 256M nodes (272 MB of compressed blocks), with 16 blocks
+ * (64 KB) of it in memory and 1.3 GB spilled over the run into a file of 268 MB, as the space of blocks read back is
+ * written again. The file was served from the page cache here, so this is the rate with the disk keeping up, the
+ * read-ahead hides the latency:
+ * All blocks in memory:                    66 M nodes/s   272 MB
+ * Spilled through io_uring:                56 M nodes/s   3.8 MB
+ * Spilled through a pread/pwrite thread:   56 M nodes/s   3.8 MB
+ *
+ * Printing 1000 copies of the 121 state trace for 10 frogs to /dev/null:
+ * Stream operators copying and std::endl:  22.3 ms    5.5 M states/s
+ * Stream operators:                        18.2 ms    6.7 M states/s
+ * trace_writer_t, text:                     5.2 ms   23.5 M states/s
+ * trace_writer_t, binary:                   1.2 ms  104.6 M states/s
+ * trace_writer_t, JSON lines:               4.8 ms   25.3 M states/s
+ *
+ * Generating the transitions of a state of 20 frogs and applying them to copies of the state:
+ * std::vector of std::function:            93 ns
+ * std::list of std::function:              79 ns
+ * transitions_t, no allocation:            64 ns
  */
 
 #include "reachability.hpp" // your header-only library solution
@@ -19,11 +87,20 @@
 #include <vector>
 #include <list>
 #include <functional> // std::function
+#include <array>
+#include <cstring>
 
 // Enable or disable benchmarking.
 // #define ENABLE_BENCHMARKING
+// Enable to solve on a cluster of 4 processes on this machine, see cluster_t.
+// #define ENABLE_DISTRIBUTED
 #ifdef ENABLE_BENCHMARKING
 #include <benchmark/benchmark.h>
+#include <fstream>
+#endif
+// Defined when linked into the command-line driver, see driver.cpp.
+#ifdef PUZZLE_DRIVER
+#include "driver.hpp"
 #endif
 
 enum class frog {
@@ -31,35 +108,50 @@ enum class frog {
 };
 using stones_t = std::vector<frog>;
 
+// Stones are packed frogs, so the state pool hashes and compares them with the packed kernels.
+template<>
+struct state_hash<stones_t> : packed_hash<stones_t> {
+};
+
+// The letter printed for a stone
+char symbol(frog stone) {
+    switch (stone) {
+        case frog::green:
+            return 'G';
+        case frog::brown:
+            return 'B';
+        default:
+            return '_';
+    }
+}
+
 // Overload to print frog positions
 std::ostream &operator<<(std::ostream &os, const stones_t &stones) {
-    for (auto &&stone: stones)
-        switch (stone) {
-            case frog::green:
-                os << "G";
-                break;
-            case frog::brown:
-                os << "B";
-                break;
-            case frog::empty:
-                os << "_";
-                break;
-        }
+    for (auto stone: stones)
+        os << symbol(stone);
     return os;
 }
 
 // Overload of << operator to print list content
 template<class StateT, template<class...> class ContainerT, typename = std::enable_if_t<!std::is_same<StateT, char>::value>>
 std::ostream &operator<<(std::ostream &os, const ContainerT<ContainerT<StateT>> &v) {
-    for (auto stones : v) {
+    for (auto &stones: v) {
         os << "State of " << stones.size() << " stones: " << stones << '\n';
     }
-    os << std::endl;
-    return os;
+    return os << '\n';
 }
 
-auto transitions(const stones_t &stones) {
-    auto res = std::vector<std::function<void(stones_t &)>>{};
+// Formats a trace state for trace_writer_t, as the overloads above print it.
+void format(trace_writer_t &out, const stones_t &stones) {
+    out << "State of " << stones.size() << " stones: ";
+    for (auto stone: stones)
+        out << symbol(stone);
+}
+
+// The moves of the frogs into a container of transitions, transitions_t or a container of std::function.
+template<class TransitionsT>
+TransitionsT stone_transitions(const stones_t &stones) {
+    auto res = TransitionsT{};
     if (stones.size() < 2)
         return res;
     auto i = 0u;
@@ -93,6 +185,32 @@ auto transitions(const stones_t &stones) {
     return res;
 }
 
+auto transitions(const stones_t &stones) {
+    return stone_transitions<transitions_t<stones_t>>(stones);
+}
+
+// Move ordering for depth-first search, see state_space_t::heuristic: frogs of a colour next to each other have to be
+// separated again by a frog of the other colour, so states with fewer of them are explored first.
+int same_neighbours(const stones_t &stones) {
+    auto count = 0;
+    for (size_t i = 0; i + 1 < stones.size(); ++i)
+        if (stones[i] != frog::empty && stones[i] == stones[i + 1])
+            ++count;
+    return count;
+}
+
+// The kind of a move for the history of state_space_t::history: the stone filled and the step to it, which is a jump
+// or a step from either side.
+size_t move_kind(const stones_t &from, const stones_t &to) {
+    size_t filled = 0, left = 0;
+    while (from[filled] != frog::empty)
+        ++filled;
+    while (to[left] != frog::empty)
+        ++left;
+    auto step = left < filled ? 2 - (filled - left) : 1 + (left - filled);
+    return 4 * filled + step;
+}
+
 void show_successors(const stones_t &state, const size_t level = 0) {
     // Caution: this function uses recursion, which is not suitable for solving puzzles!!
     // 1) some state spaces can be deeper than stack allows.
@@ -130,31 +248,88 @@ void explain() {
     }
 }
 
-void solve(size_t frogs, search_order order = search_order::breadth_first) {
-    const auto stones = frogs * 2 + 1; // frogs on either side and 1 empty in the middle
-    auto start = stones_t(stones, frog::empty);  // initially all empty
-    auto finish = stones_t(stones, frog::empty); // initially all empty
-    while (frogs-- > 0) { // count down from frogs-1 to 0 and put frogs into positions:
-        start[frogs] = frog::green;                  // green on left
-        start[start.size() - frogs - 1] = frog::brown;   // brown on right
-        finish[frogs] = frog::brown;                 // brown on left
-        finish[finish.size() - frogs - 1] = frog::green; // green on right
+// The start and finish boards for the given number of frogs on either side and 1 empty stone in the middle: green on
+// the left and brown on the right, and swapped for the finish.
+std::pair<stones_t, stones_t> boards(size_t frogs) {
+    auto start = stones_t(frogs * 2 + 1, frog::empty);
+    auto finish = stones_t(frogs * 2 + 1, frog::empty);
+    for (size_t i = 0; i < frogs; ++i) {
+        start[i] = finish[finish.size() - i - 1] = frog::green;
+        start[start.size() - i - 1] = finish[i] = frog::brown;
     }
+    return {std::move(start), std::move(finish)};
+}
+
+void solve(size_t frogs, search_order order = search_order::breadth_first) {
+    auto [start, finish] = boards(frogs);
     std::cout << "Leaping frog puzzle start: " << start << ", finish: " << finish << '\n';
     auto space = state_space_t{
             std::move(start),                 // initial state
             successors<stones_t>(transitions) // successor-generating function from your library
     };
-    auto solutions = space.check(
+    // The traces are printed as the search finds them.
+    trace_writer_t out(std::cout);
+    space.check(
             [finish = std::move(finish)](const stones_t &state) { return state == finish; },
+            [&out](std::vector<stones_t> &&trace) {
+                out << "Solution: trace of " << trace.size() << " states\n";
+                out.trace(trace, format);
+                out << "\n\n";
+            },
             order);
-    for (u_int i = 0; i < solutions.size(); i++) {
-        std::cout << "Solution: trace of " << solutions[i].size() << " states\n";
-        std::cout << solutions[i] << std::endl;
+}
+
+#ifdef ENABLE_DISTRIBUTED
+// Solves with the states partitioned among the processes of a cluster, only rank 0 receives and reports the traces.
+void solve(size_t frogs, cluster_t &cluster) {
+    auto [start, finish] = boards(frogs);
+    auto space = state_space_t{
+            start,                            // initial state
+            successors<stones_t>(transitions) // successor-generating function from your library
+    };
+    auto solutions = space.check(
+            [finish = finish](const stones_t &state) { return state == finish; },
+            cluster);
+    if (cluster.rank() != 0)
+        return;
+    std::cout << "Leaping frog puzzle start: " << start << ", finish: " << finish << " on " << cluster.size()
+              << " processes\n";
+    for (auto &&trace: solutions) {
+        std::cout << "Solution: trace of " << trace.size() << " states\n";
+        std::cout << trace << '\n';
     }
 }
+#endif
 
-#ifndef ENABLE_BENCHMARKING
+#ifdef PUZZLE_DRIVER
+// The size is the number of frogs on either side, the variant orders the moves of depth-first search: heuristic,
+// history or both.
+static model_registration_t frogs_model{
+        "frogs", "leaping frogs, the size is the frogs on either side (2), the variant orders depth-first moves: "
+                 "heuristic, history or heuristic-history",
+        [](const run_config_t &config, trace_writer_t &out) {
+            auto [start, finish] = boards(config.size ? config.size : 2);
+            auto space = state_space_t{std::move(start), successors<stones_t>(transitions)};
+            if (config.variant == "heuristic" || config.variant == "heuristic-history")
+                space.heuristic(&same_neighbours);
+            if (config.variant == "history" || config.variant == "heuristic-history")
+                space.history(&move_kind, 4 * finish.size());
+            else if (!config.variant.empty() && config.variant != "heuristic")
+                throw std::invalid_argument("unknown frogs move ordering " + config.variant);
+            return search(
+                    config, space, [&finish = finish](const stones_t &state) { return state == finish; },
+                    [&](std::vector<stones_t> &&trace) { write_trace(config, out, trace, format); });
+        }};
+#endif
+
+#if !defined(ENABLE_BENCHMARKING) && !defined(PUZZLE_DRIVER)
+#ifdef ENABLE_DISTRIBUTED
+int main() {
+    auto cluster = cluster_t::loopback(4); // 4 processes on this machine
+    solve(2, cluster);
+    solve(4, cluster);
+}
+#else
 int main() {
     explain();
     std::cout << "--- Solve with depth-first search: ---\n";
@@ -162,6 +337,7 @@ int main() {
     solve(4); // 20 frogs may take >5.8GB of memory
 }
 #endif
+#endif
 
 #ifdef ENABLE_BENCHMARKING
 // Enable for benchmarking
@@ -175,5 +351,250 @@ void BM_main(benchmark::State& state){
 }
 
 BENCHMARK(BM_main)->Iterations(1000);
+
+// Generates the transitions of a state of 20 frogs around the middle of a solution and applies them to copies.
+template<class TransitionsT>
+void BM_transitions(benchmark::State &state) {
+    auto stones = stones_t(41, frog::green);
+    std::fill(stones.begin() + 20, stones.end(), frog::brown);
+    stones[19] = frog::brown;
+    stones[20] = frog::empty;
+    stones[21] = frog::green;
+    auto successor = stones;
+    for (auto _ : state) {
+        auto transitions = stone_transitions<TransitionsT>(stones);
+        for (auto &transition: transitions) {
+            successor = stones;
+            transition(successor);
+            benchmark::DoNotOptimize(successor);
+        }
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_transitions, std::vector<std::function<void(stones_t &)>>);
+BENCHMARK_TEMPLATE(BM_transitions, std::list<std::function<void(stones_t &)>>);
+BENCHMARK_TEMPLATE(BM_transitions, transitions_t<stones_t>);
+
+// Hashing and comparing stones of 4 and 20 frogs with the element-wise hash and the packed kernels.
+void BM_hash_elementwise(benchmark::State &state) {
+    auto stones = stones_t(static_cast<size_t>(state.range(0)), frog::brown);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(reachability_detail::hash_value(stones, reachability_detail::priority<1>{}));
+    }
+}
+
+template<hash_kernel Kernel>
+void BM_hash(benchmark::State &state) {
+    auto stones = stones_t(static_cast<size_t>(state.range(0)), frog::brown);
+    auto hash = packed_hash<stones_t, Kernel>{};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(hash(stones));
+    }
+}
+
+void BM_equal_operator(benchmark::State &state) {
+    auto stones = stones_t(static_cast<size_t>(state.range(0)), frog::brown);
+    auto other = stones;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(stones == other);
+    }
+}
+
+template<hash_kernel Kernel>
+void BM_equal(benchmark::State &state) {
+    auto stones = stones_t(static_cast<size_t>(state.range(0)), frog::brown);
+    auto other = stones;
+    auto hash = packed_hash<stones_t, Kernel>{};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(hash.equal(stones, other));
+    }
+}
+
+// Probes a state pool holding the given number of 4 frog boards with a block of 64 random boards at a time, one by
+// one or as a prefetching batch. The largest pool (about 900 MB) exceeds the last level cache.
+using board_t = std::array<frog, 9>;
+
+template<>
+struct state_hash<board_t> : packed_hash<board_t> {
+};
+
+// Distinct boards for distinct indices, the index bits fill the first two stones.
+board_t board(uint64_t index) {
+    auto result = board_t{};
+    std::memcpy(result.data(), &index, sizeof(index));
+    return result;
+}
+
+template<bool Batched, bool HugePages = true>
+void BM_pool_probe(benchmark::State &state) {
+    auto size = static_cast<uint64_t>(state.range(0));
+    large_table_policy::hugePages = HugePages;
+    state_pool_t<board_t> pool;
+    for (uint64_t i = 0; i < size; ++i)
+        pool.intern(board(i));
+    auto block = std::vector<board_t>(64);
+    auto ids = std::vector<state_id_t>{};
+    uint64_t next = 0x9e3779b97f4a7c15ULL;
+    for (auto _ : state) {
+        for (auto &b: block) {
+            next = next * 6364136223846793005ULL + 1442695040888963407ULL;
+            b = board((next >> 16) % size);
+        }
+        if (Batched) {
+            pool.internBatch(block.data(), block.size(), ids);
+        } else {
+            for (auto &b: block)
+                benchmark::DoNotOptimize(pool.intern(b));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * 64);
+}
+
+BENCHMARK_TEMPLATE(BM_pool_probe, false, false)->RangeMultiplier(16)->Range(1 << 12, 1 << 24);
+BENCHMARK_TEMPLATE(BM_pool_probe, true, false)->RangeMultiplier(16)->Range(1 << 12, 1 << 24);
+BENCHMARK_TEMPLATE(BM_pool_probe, false, true)->RangeMultiplier(16)->Range(1 << 12, 1 << 24);
+BENCHMARK_TEMPLATE(BM_pool_probe, true, true)->RangeMultiplier(16)->Range(1 << 12, 1 << 24);
+BENCHMARK(BM_hash_elementwise)->Arg(9)->Arg(41)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_hash, hash_kernel::automatic)->Arg(9)->Arg(41)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_hash, hash_kernel::wyhash)->Arg(9)->Arg(41)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_hash, hash_kernel::crc32)->Arg(9)->Arg(41)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_hash, hash_kernel::avx2)->Arg(9)->Arg(41)->Arg(1024);
+BENCHMARK(BM_equal_operator)->Arg(9)->Arg(41)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_equal, hash_kernel::automatic)->Arg(9)->Arg(41)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_equal, hash_kernel::avx2)->Arg(9)->Arg(41)->Arg(1024);
+
+// Solving the puzzle breadth-first with the state pool and with sorted layers checked against the given number of
+// previous layers (0 for all of them).
+template<search_order Order>
+void BM_breadth_first(benchmark::State &state) {
+    auto frogs = static_cast<size_t>(state.range(0));
+    sorted_search_policy::duplicateLayers = static_cast<size_t>(state.range(1));
+    auto [start, finish] = boards(frogs);
+    for (auto _ : state) {
+        auto space = state_space_t{start, successors<stones_t>(transitions)};
+        benchmark::DoNotOptimize(space.check([&finish = finish](const stones_t &s) { return s == finish; }, Order));
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_breadth_first, search_order::breadth_first)->Args({14, 0})->Args({18, 0})
+        ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_breadth_first, search_order::sorted_breadth_first)->Args({14, 0})->Args({18, 0})
+        ->Args({14, 2})->Args({18, 2})->Unit(benchmark::kMillisecond);
+
+// Solving the puzzle by iterative deepening without and with a nogood table of the given number of entries.
+void BM_iterative_deepening(benchmark::State &state) {
+    auto frogs = static_cast<size_t>(state.range(0));
+    deepening_search_policy::nogoods = static_cast<size_t>(state.range(1));
+    auto [start, finish] = boards(frogs);
+    for (auto _ : state) {
+        auto space = state_space_t{start, successors<stones_t>(transitions)};
+        benchmark::DoNotOptimize(space.check([&finish = finish](const stones_t &s) { return s == finish; },
+                                             search_order::iterative_deepening));
+    }
+}
+
+// Finding the first solution depth-first with the moves as generated, ordered by same_neighbours and ordered by the
+// history of move_kind. The space is kept between iterations, so the history learns from the searches before.
+void BM_first_solution(benchmark::State &state) {
+    auto frogs = static_cast<size_t>(state.range(0));
+    auto [start, finish] = boards(frogs);
+    auto space = state_space_t{start, successors<stones_t>(transitions)};
+    if (state.range(1) == 1)
+        space.heuristic(&same_neighbours);
+    else if (state.range(1) == 2)
+        space.history(&move_kind, 4 * start.size());
+    depth_first_policy::firstSolution = true;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(space.check([&finish = finish](const stones_t &s) { return s == finish; },
+                                             search_order::depth_first));
+    }
+    depth_first_policy::firstSolution = false;
+}
+
+BENCHMARK(BM_first_solution)->Args({12, 0})->Args({16, 0})->Args({12, 1})->Args({16, 1})->Args({12, 2})
+        ->Args({16, 2})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_iterative_deepening)->Args({8, 0})->Args({10, 0})->Args({8, 16384})->Args({10, 16384})
+        ->Unit(benchmark::kMillisecond);
+
+// Printing the given number of copies of the solution trace for 10 frogs to /dev/null: with the stream operators as
+// they were (iterating by value and ending every line with std::endl), with the current ones, and with trace_writer_t
+// as text, in the binary format and as JSON lines.
+enum class printing {
+    copying_endl, stream, writer, binary, json
+};
+
+template<printing Printing>
+void BM_print_traces(benchmark::State &state) {
+    auto [start, finish] = boards(10);
+    auto space = state_space_t{start, successors<stones_t>(transitions)};
+    auto solution = space.check([&finish = finish](const stones_t &s) { return s == finish; }).front();
+    auto traces = std::vector<std::vector<stones_t>>(static_cast<size_t>(state.range(0)), solution);
+    std::ofstream os("/dev/null");
+    for (auto _ : state) {
+        if constexpr (Printing == printing::copying_endl) {
+            for (auto trace: traces) {
+                for (auto stones: trace)
+                    os << "State of " << stones.size() << " stones: " << stones << '\n';
+                os << std::endl;
+            }
+        } else if constexpr (Printing == printing::stream) {
+            for (auto &trace: traces)
+                os << trace;
+            os.flush();
+        } else {
+            trace_writer_t out(os);
+            for (auto &trace: traces) {
+                if constexpr (Printing == printing::writer)
+                    out.trace(trace, format);
+                else if constexpr (Printing == printing::binary)
+                    out.binaryTrace(trace);
+                else
+                    out.jsonTrace(trace);
+            }
+            if constexpr (Printing == printing::binary)
+                out.binaryIndex();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(traces.size() * solution.size()));
+}
+
+BENCHMARK_TEMPLATE(BM_print_traces, printing::copying_endl)->Arg(1000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_print_traces, printing::stream)->Arg(1000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_print_traces, printing::writer)->Arg(1000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_print_traces, printing::binary)->Arg(1000)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_print_traces, printing::json)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+#ifdef __linux__
+// Popping and pushing a breadth-first frontier of the given number of nodes, with the given number of blocks kept in
+// memory (0 for all of them) and spilled through io_uring or the thread backend. Every popped node is replaced by a
+// new one, as by an expansion generating a single new state.
+template<bool Uring>
+void BM_spilled_frontier(benchmark::State &state) {
+    auto nodes = static_cast<size_t>(state.range(0));
+    spill_policy::memoryBlocks = static_cast<size_t>(state.range(1));
+    spill_policy::uring = Uring;
+    frontier_blocks_t frontier;
+    trace_store_t::node_t next = 0;
+    for (size_t i = 0; i < nodes; ++i) {
+        frontier.push_back(next);
+        next += 1 + i % 3;
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(frontier.front());
+        frontier.pop_front();
+        frontier.push_back(next);
+        next += 1 + next % 3;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["spilled MB"] = static_cast<double>(frontier.spilled()) / 1e6;
+    state.counters["memory MB"] = static_cast<double>(frontier.memory()) / 1e6;
+    state.counters["file MB"] = static_cast<double>(frontier.spillFile()) / 1e6;
+    spill_policy::memoryBlocks = 0;
+}
+
+BENCHMARK_TEMPLATE(BM_spilled_frontier, true)->Args({1 << 28, 0})->Args({1 << 28, 16})
+        ->Iterations(1 << 30);
+BENCHMARK_TEMPLATE(BM_spilled_frontier, false)->Args({1 << 28, 16})->Iterations(1 << 30);
+#endif
 BENCHMARK_MAIN();
 #endif
@@ -0,0 +1,193 @@
+/**
+ * Leaping frogs on a long pond: a variant of frogs.cpp with hundreds of stones, where frogs may jump into any empty
+ * stone. Every move touches at most two stones, so the state is a persistent_array which shares all untouched chunks
+ * between a state and its successors instead of copying the whole pond.
+ * Compile and run:
+ * g++ -std=c++17 -pedantic -Wall -DNDEBUG -O3 -o frogs_large frogs_large.cpp && ./frogs_large
+ */
+
+/** Benchmark results (stones: 256 / 1024 / 4096):
+ * g++ frogs_large.cpp --std=c++17 -lbenchmark -lpthread -O3 -o benchmarkfrogs_large && ./benchmarkfrogs_large
+ * Copy and apply all transitions, std::vector:           108 ns /  302 ns /  858 ns
+ * Copy and apply all transitions, 32 frog chunks:        245 ns /  855 ns / 3064 ns
+ * Copy and apply all transitions, 256 frog chunks:       455 ns /  450 ns /  558 ns
+ * Compare with successor, std::vector:                   156 ns /  578 ns / 2881 ns
+ * Compare with successor, 32 frog chunks:                 34 ns /   67 ns /  196 ns
+ * Compare with successor, 256 frog chunks:               191 ns /  200 ns /  199 ns
+ * Search with a frog on either side (stones: 64 / 128 / 256), passed states in the hash table of the engine:
+ * std::vector:                                          8.3 ms / 71.4 ms /  562 ms
+ * 32 frog chunks:                                       5.5 ms / 32.8 ms /  173 ms
+ * 256 frog chunks:                                      9.4 ms / 46.0 ms /  223 ms
+ * A chunk pointer copy is an atomic reference count increment, so copying alone is 2.3-3.6x slower with 32 frog
+ * chunks than with std::vector and only 256 frog chunks catch up, at thousands of stones. A search does more than
+ * copy: it hashes and compares the successors with the passed states and stores the new ones, and small chunks skip
+ * most of that work as a successor shares all but one or two chunks. The demo solves 256 stones, where 32 frog chunks
+ * search 3.2x faster than std::vector and 1.3x faster than 256 frog chunks, which hold the whole pond in one chunk.
+ */
+
+#include "reachability.hpp" // your header-only library solution
+
+#include <iostream>
+#include <vector>
+#include <functional> // std::function
+
+// Enable or disable benchmarking.
+// #define ENABLE_BENCHMARKING
+#ifdef ENABLE_BENCHMARKING
+#include <benchmark/benchmark.h>
+#endif
+
+enum class frog {
+    empty, green, brown
+};
+using pond_t = persistent_array<frog, 32>;
+
+// Overload to print frog positions
+std::ostream &operator<<(std::ostream &os, const pond_t &stones) {
+    for (auto &&stone: stones)
+        switch (stone) {
+            case frog::green:
+                os << "G";
+                break;
+            case frog::brown:
+                os << "B";
+                break;
+            case frog::empty:
+                os << "_";
+                break;
+        }
+    return os;
+}
+
+// Green frogs jump to the right and brown frogs to the left, either to the next stone or over one frog.
+template<class StonesT>
+auto pond_transitions(const StonesT &stones) {
+    auto res = std::vector<std::function<void(StonesT &)>>{};
+    for (auto i = 0u; i < stones.size(); ++i) {
+        if (stones[i] != frog::empty)
+            continue;
+        if (i > 0 && stones[i - 1] == frog::green)
+            res.push_back([i](StonesT &s) { // green jump to next
+                s[i - 1] = frog::empty;
+                s[i] = frog::green;
+            });
+        if (i > 1 && stones[i - 2] == frog::green && stones[i - 1] != frog::empty)
+            res.push_back([i](StonesT &s) { // green jump over 1
+                s[i - 2] = frog::empty;
+                s[i] = frog::green;
+            });
+        if (i + 1 < stones.size() && stones[i + 1] == frog::brown)
+            res.push_back([i](StonesT &s) { // brown jump to next
+                s[i + 1] = frog::empty;
+                s[i] = frog::brown;
+            });
+        if (i + 2 < stones.size() && stones[i + 2] == frog::brown && stones[i + 1] != frog::empty)
+            res.push_back([i](StonesT &s) { // brown jump over 1
+                s[i + 2] = frog::empty;
+                s[i] = frog::brown;
+            });
+    }
+    return res;
+}
+
+auto transitions(const pond_t &stones) {
+    return pond_transitions(stones);
+}
+
+// Puts the frogs on either end of the pond, or swapped for the finish.
+pond_t pond(size_t stones, size_t frogs, bool swapped) {
+    auto result = pond_t(stones, frog::empty);
+    for (size_t i = 0; i < frogs; ++i) {
+        result[i] = swapped ? frog::brown : frog::green;
+        result[stones - i - 1] = swapped ? frog::green : frog::brown;
+    }
+    return result;
+}
+
+void solve(size_t stones, size_t frogs, search_order order = search_order::breadth_first) {
+    auto start = pond(stones, frogs, false);
+    auto finish = pond(stones, frogs, true);
+    std::cout << "Leaping frogs on a pond of " << stones << " stones with " << frogs << " frogs on each side\n";
+    auto space = state_space_t{
+            std::move(start),               // initial state
+            successors<pond_t>(transitions) // successor-generating function from your library
+    };
+    auto solutions = space.check(
+            [finish = std::move(finish)](const pond_t &state) { return state == finish; },
+            order);
+    for (auto &&trace: solutions) {
+        std::cout << "Solution: trace of " << trace.size() << " states, the first and last are\n";
+        std::cout << trace.front() << '\n' << trace.back() << '\n';
+        std::cout << "Consecutive states share " << trace[1].sharedChunks(trace[0]) << " of "
+                  << (stones + 31) / 32 << " chunks\n";
+    }
+}
+
+#ifndef ENABLE_BENCHMARKING
+int main() {
+    solve(256, 1);
+}
+#endif
+
+#ifdef ENABLE_BENCHMARKING
+// Copies a pond state and applies every transition, as the engine does for each expanded state.
+template<class StonesT>
+void BM_successors(benchmark::State &state) {
+    auto size = static_cast<size_t>(state.range(0));
+    auto stones = StonesT(size, frog::empty);
+    stones[0] = frog::green;
+    stones[1] = frog::green;
+    stones[size - 2] = frog::brown;
+    stones[size - 1] = frog::brown;
+    auto trans = pond_transitions(stones);
+    for (auto _ : state) {
+        for (auto &transition: trans) {
+            auto successor{stones};
+            transition(successor);
+            benchmark::DoNotOptimize(successor);
+        }
+    }
+}
+
+// Compares a state with its successor, as the engine does when looking for already passed states.
+template<class StonesT>
+void BM_equality(benchmark::State &state) {
+    auto size = static_cast<size_t>(state.range(0));
+    auto stones = StonesT(size, frog::empty);
+    stones[0] = frog::green;
+    stones[size - 2] = frog::brown;
+    auto successor{stones};
+    successor[size - 1] = frog::brown;
+    successor[size - 2] = frog::empty;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(stones == successor);
+    }
+}
+
+// Searches a pond with a frog on either side to the end, with the passed states in the hash table of the engine.
+template<class StonesT>
+void BM_search(benchmark::State &state) {
+    auto size = static_cast<size_t>(state.range(0));
+    auto start = StonesT(size, frog::empty);
+    start[0] = frog::green;
+    start[size - 1] = frog::brown;
+    auto finish = StonesT(size, frog::empty);
+    finish[0] = frog::brown;
+    finish[size - 1] = frog::green;
+    for (auto _ : state) {
+        auto space = state_space_t{start, successors<StonesT>(pond_transitions<StonesT>)};
+        benchmark::DoNotOptimize(space.check([&finish](const StonesT &stones) { return stones == finish; }));
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_successors, std::vector<frog>)->Arg(256)->Arg(1024)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_successors, pond_t)->Arg(256)->Arg(1024)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_successors, persistent_array<frog, 256>)->Arg(256)->Arg(1024)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_equality, std::vector<frog>)->Arg(256)->Arg(1024)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_equality, pond_t)->Arg(256)->Arg(1024)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_equality, persistent_array<frog, 256>)->Arg(256)->Arg(1024)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_search, std::vector<frog>)->Arg(64)->Arg(128)->Arg(256)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_search, pond_t)->Arg(64)->Arg(128)->Arg(256)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_search, persistent_array<frog, 256>)->Arg(64)->Arg(128)->Arg(256)->Unit(benchmark::kMillisecond);
+BENCHMARK_MAIN();
+#endif
@@ -12,243 +12,6048 @@
 #ifndef PUZZLEENGINE_REACHABILITY_HPP
 #define PUZZLEENGINE_REACHABILITY_HPP
 
-#include <list> // For list
+#include <deque> // For frontier blocks
 #include <queue> // For priority queue
+#include <vector> // For state pool and trace store
 #include <functional> // For function
+#include <initializer_list> // For small_vector
 #include <iostream> // For cout
-#include <memory> // For smart pointers
+#include <algorithm> // For fill, min
+#include <cstring> // For memcpy
+#include <stdexcept> // For length_error
+#include <type_traits> // For state hash selection
+#include <fstream> // For reading the NUMA topology
+#include <string> // For to_string
+#include <charconv> // For to_chars
+#include <iterator> // For distance
+#include <thread> // For hardware_concurrency
+#include <new> // For bad_alloc
+#include <exception> // For exception_ptr
+#include <cstdlib> // For getenv, mkstemp
+#include <mutex> // For the spill file thread
+#include <shared_mutex> // For shared graph shards
+#include <condition_variable> // For the spill file thread
+#include <unordered_map> // For pending spill file requests
+#if defined(__x86_64__)
+#include <immintrin.h> // For CRC32 and AVX2 kernels
+#endif
+#ifdef __linux__
+#include <sys/mman.h> // For mmap, madvise
+#include <sys/syscall.h> // For mbind
+#include <unistd.h> // For syscall
+#include <pthread.h> // For thread pinning
+#include <sched.h> // For cpu sets
+#include <sys/socket.h> // For cluster connections
+#include <sys/wait.h> // For waitpid
+#include <netinet/in.h> // For loopback addresses
+#include <netinet/tcp.h> // For TCP_NODELAY
+#include <netdb.h> // For getaddrinfo
+#include <poll.h> // For poll
+#include <fcntl.h> // For non-blocking sockets
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h> // For asynchronous spill file requests
+#define PUZZLEENGINE_IO_URING
+#endif
+#endif
+#include <cerrno> // For errno
+#include <system_error> // For system_error
+#include <chrono> // For connection retries
+#include <map> // For gathering distributed traces
+#include <cstdint> // For fixed width integers
+#include <cstddef> // For max_align_t
+#include <array> // For persistent array chunks
+#include <atomic> // For cached chunk hashes and lock-free queues
+#include <memory> // For shared chunks
+#include <optional> // For nogood budgets
+#include <set> // For free spill file extents
 
-// Search order enum for requirement 4
+// Search order enum for requirement 4, sorted_breadth_first is breadth-first with sort-based duplicate detection, see
+// packed_layers_t, and iterative_deepening is depth-first search under a growing depth bound, see
+// deepening_search_policy.
 enum class search_order {
-    breadth_first, depth_first
+    breadth_first, depth_first, sorted_breadth_first, iterative_deepening
+};
+
+// Callable of a fixed signature holding its closure in place, where std::function may allocate the closure on the
+// heap. Closures larger than Capacity bytes do not compile.
+template<class SignatureT, std::size_t Capacity = 4 * sizeof(void *)>
+class inplace_function;
+
+template<class R, class... Args, std::size_t Capacity>
+class inplace_function<R(Args...), Capacity> {
+public:
+    inplace_function() = default;
+
+    template<class F, class = std::enable_if_t<!std::is_same<std::decay_t<F>, inplace_function>::value>>
+    inplace_function(F &&f) {
+        using closure_t = std::decay_t<F>;
+        static_assert(sizeof(closure_t) <= Capacity, "The closure exceeds the capacity of the inplace_function.");
+        static_assert(alignof(closure_t) <= alignof(std::max_align_t), "The closure is over-aligned.");
+        new(_storage) closure_t(std::forward<F>(f));
+        _operations = &operations<closure_t>;
+    }
+
+    inplace_function(const inplace_function &other) : _operations(other._operations) {
+        if (_operations)
+            _operations->copy(_storage, other._storage);
+    }
+
+    inplace_function(inplace_function &&other) noexcept: _operations(other._operations) {
+        if (_operations)
+            _operations->move(_storage, other._storage);
+    }
+
+    inplace_function &operator=(const inplace_function &other) {
+        if (this != &other) {
+            reset();
+            if (other._operations)
+                other._operations->copy(_storage, other._storage);
+            _operations = other._operations;
+        }
+        return *this;
+    }
+
+    inplace_function &operator=(inplace_function &&other) noexcept {
+        if (this != &other) {
+            reset();
+            if (other._operations)
+                other._operations->move(_storage, other._storage);
+            _operations = other._operations;
+        }
+        return *this;
+    }
+
+    ~inplace_function() {
+        reset();
+    }
+
+    R operator()(Args... args) const {
+        return _operations->invoke(_storage, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const {
+        return _operations != nullptr;
+    }
+
+private:
+    struct operations_t {
+        R (*invoke)(void *closure, Args &&... args);
+        void (*copy)(void *to, const void *from);
+        void (*move)(void *to, void *from);
+        void (*destroy)(void *closure);
+    };
+
+    template<class ClosureT>
+    static constexpr operations_t operations{
+            [](void *closure, Args &&... args) -> R {
+                return (*static_cast<ClosureT *>(closure))(std::forward<Args>(args)...);
+            },
+            [](void *to, const void *from) { new(to) ClosureT(*static_cast<const ClosureT *>(from)); },
+            [](void *to, void *from) { new(to) ClosureT(std::move(*static_cast<ClosureT *>(from))); },
+            [](void *closure) { static_cast<ClosureT *>(closure)->~ClosureT(); }
+    };
+
+    // Mutable as std::function, a const function may still call a closure changing its captures.
+    alignas(std::max_align_t) mutable unsigned char _storage[Capacity];
+    const operations_t *_operations = nullptr;
+
+    void reset() {
+        if (_operations) {
+            _operations->destroy(_storage);
+            _operations = nullptr;
+        }
+    }
+};
+
+// Vector keeping up to N elements in place and only moving them to the heap beyond, for short lists built and dropped
+// for every expanded state, such as its transitions.
+template<class T, std::size_t N>
+class small_vector {
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using iterator = T *;
+    using const_iterator = const T *;
+
+    small_vector() = default;
+
+    small_vector(std::initializer_list<T> items) {
+        reserve(items.size());
+        for (auto &item: items) {
+            push_back(item);
+        }
+    }
+
+    small_vector(const small_vector &other) {
+        reserve(other._size);
+        for (auto &item: other) {
+            push_back(item);
+        }
+    }
+
+    small_vector(small_vector &&other) noexcept(std::is_nothrow_move_constructible<T>::value) {
+        take(other);
+    }
+
+    small_vector &operator=(const small_vector &other) {
+        if (this != &other) {
+            clear();
+            reserve(other._size);
+            for (auto &item: other) {
+                push_back(item);
+            }
+        }
+        return *this;
+    }
+
+    small_vector &operator=(small_vector &&other) noexcept(std::is_nothrow_move_constructible<T>::value) {
+        if (this != &other) {
+            release();
+            take(other);
+        }
+        return *this;
+    }
+
+    ~small_vector() {
+        release();
+    }
+
+    void push_back(const T &item) {
+        emplace_back(item);
+    }
+
+    void push_back(T &&item) {
+        emplace_back(std::move(item));
+    }
+
+    template<class... Args>
+    T &emplace_back(Args &&... args) {
+        if (_size == _capacity) {
+            // The argument may refer to an element, so it is constructed before the elements move.
+            T item(std::forward<Args>(args)...);
+            reserve(_capacity * 2);
+            return *new(_data + _size++) T(std::move(item));
+        }
+        return *new(_data + _size++) T(std::forward<Args>(args)...);
+    }
+
+    void pop_back() {
+        _data[--_size].~T();
+    }
+
+    void clear() {
+        for (std::size_t i = 0; i < _size; ++i) {
+            _data[i].~T();
+        }
+        _size = 0;
+    }
+
+    void reserve(std::size_t capacity) {
+        if (capacity <= _capacity)
+            return;
+        auto data = static_cast<T *>(::operator new(capacity * sizeof(T)));
+        for (std::size_t i = 0; i < _size; ++i) {
+            new(data + i) T(std::move(_data[i]));
+            _data[i].~T();
+        }
+        if (_data != inlineData())
+            ::operator delete(_data);
+        _data = data;
+        _capacity = capacity;
+    }
+
+    std::size_t size() const {
+        return _size;
+    }
+
+    bool empty() const {
+        return _size == 0;
+    }
+
+    std::size_t capacity() const {
+        return _capacity;
+    }
+
+    T *data() {
+        return _data;
+    }
+
+    const T *data() const {
+        return _data;
+    }
+
+    T &operator[](std::size_t i) {
+        return _data[i];
+    }
+
+    const T &operator[](std::size_t i) const {
+        return _data[i];
+    }
+
+    T &front() {
+        return _data[0];
+    }
+
+    const T &front() const {
+        return _data[0];
+    }
+
+    T &back() {
+        return _data[_size - 1];
+    }
+
+    const T &back() const {
+        return _data[_size - 1];
+    }
+
+    iterator begin() {
+        return _data;
+    }
+
+    iterator end() {
+        return _data + _size;
+    }
+
+    const_iterator begin() const {
+        return _data;
+    }
+
+    const_iterator end() const {
+        return _data + _size;
+    }
+
+private:
+    alignas(T) unsigned char _inline[N * sizeof(T)];
+    T *_data = inlineData();
+    std::size_t _size = 0;
+    std::size_t _capacity = N;
+
+    T *inlineData() {
+        return reinterpret_cast<T *>(_inline);
+    }
+
+    // Takes the elements of other, which is left empty: heap elements by their pointer and inline elements by moving.
+    void take(small_vector &other) {
+        if (other._data != other.inlineData()) {
+            _data = other._data;
+            _size = other._size;
+            _capacity = other._capacity;
+            other._data = other.inlineData();
+            other._size = 0;
+            other._capacity = N;
+            return;
+        }
+        for (std::size_t i = 0; i < other._size; ++i) {
+            new(_data + i) T(std::move(other._data[i]));
+        }
+        _size = other._size;
+        other.clear();
+    }
+
+    void release() {
+        clear();
+        if (_data != inlineData()) {
+            ::operator delete(_data);
+            _data = inlineData();
+            _capacity = N;
+        }
+    }
+};
+
+// The transitions of a state as the engine takes them: a transition is held in place, and up to 16 transitions are
+// held in place as well, so generating the transitions of a state allocates no memory. A transition may capture as
+// much as a std::function, which the transitions of generators returning std::function are held in.
+template<class StateT>
+using transitions_t = small_vector<inplace_function<void(StateT &), std::max(4 * sizeof(void *),
+                                                                               sizeof(std::function<void()>))>, 16>;
+
+// A successor generator made by successors(). ContainerT is the container of the traces of the state space.
+template<class StateT, template<class...> class ContainerT>
+struct successor_generator_t {
+    std::function<transitions_t<StateT>(StateT &)> generate;
 };
 
 // Requirement 1: A generic successor generator function.
+// A generator returning a container of std::function, which sets the container of the traces as well.
 template<class StateT, template<class...> class ContainerT>
-std::function<ContainerT<std::function<void(StateT &)>>(StateT &)>
+successor_generator_t<StateT, ContainerT>
 successors(ContainerT<std::function<void(StateT &)>> (*transitions)(const StateT &)) {
-    return transitions;
+    return {[transitions](StateT &state) {
+        transitions_t<StateT> result;
+        for (auto &transition: transitions(state)) {
+            result.emplace_back(std::move(transition));
+        }
+        return result;
+    }};
+}
+
+// A generator returning transitions_t, which allocates nothing. The traces are held in ContainerT, std::vector unless
+// given, as in successors<state_t, std::list>(transitions).
+template<class StateT, template<class...> class ContainerT = std::vector>
+successor_generator_t<StateT, ContainerT> successors(transitions_t<StateT> (*transitions)(const StateT &)) {
+    return {transitions};
+}
+
+// Persistent array for large states where each transition only touches a small region. The elements are split into
+// fixed size chunks that are shared between copies, so copying a state only copies chunk pointers and writing an
+// element copies only the chunk it lives in (copy-on-write). Equality and hashing skip chunks shared by both sides.
+template<class T, std::size_t ChunkSize = 64>
+class persistent_array {
+private:
+    struct chunk_t {
+        std::array<T, ChunkSize> values{};
+        // Cached hash of the values, 0 when not yet computed. Only valid while the chunk is not written to.
+        mutable std::atomic<std::size_t> hash{0};
+
+        chunk_t() = default;
+
+        chunk_t(const chunk_t &other) : values(other.values) {}
+    };
+
+    std::vector<std::shared_ptr<chunk_t>> _chunks;
+    std::size_t _size = 0;
+
+    // Returns a chunk that is not shared with any other array, copying it if needed.
+    chunk_t &writable(std::size_t index) {
+        auto &chunk = _chunks[index / ChunkSize];
+        if (chunk.use_count() > 1) {
+            chunk = std::make_shared<chunk_t>(*chunk);
+        } else {
+            chunk->hash.store(0, std::memory_order_relaxed);
+        }
+        return *chunk;
+    }
+
+    static std::size_t chunkHash(const chunk_t &chunk) {
+        auto result = chunk.hash.load(std::memory_order_relaxed);
+        if (result == 0) {
+            result = ChunkSize;
+            for (auto &value: chunk.values) {
+                result ^= std::hash<T>{}(value) + 0x9e3779b97f4a7c15ULL + (result << 6) + (result >> 2);
+            }
+            result = result == 0 ? 1 : result;
+            chunk.hash.store(result, std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+public:
+    using value_type = T;
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T *;
+        using reference = const T &;
+
+        const_iterator(const persistent_array *array, std::size_t index) : _array(array), _index(index) {}
+
+        reference operator*() const { return (*_array)[_index]; }
+
+        const_iterator &operator++() {
+            ++_index;
+            return *this;
+        }
+
+        bool operator==(const const_iterator &other) const { return _index == other._index; }
+
+        bool operator!=(const const_iterator &other) const { return _index != other._index; }
+
+    private:
+        const persistent_array *_array;
+        std::size_t _index;
+    };
+
+    // An element of a mutable array. Assigning calls set(), so no reference into a chunk outlives a write and every
+    // write clears the cached hash, which a plain T& written after hash() or operator== would leave stale.
+    class reference {
+    public:
+        reference(persistent_array *array, std::size_t index) : _array(array), _index(index) {}
+
+        reference &operator=(const T &value) {
+            _array->set(_index, value);
+            return *this;
+        }
+
+        reference &operator=(const reference &other) {
+            return *this = static_cast<const T &>(other);
+        }
+
+        operator const T &() const { return static_cast<const persistent_array &>(*_array)[_index]; }
+
+    private:
+        persistent_array *_array;
+        std::size_t _index;
+    };
+
+    persistent_array() = default;
+
+    // All full chunks of a freshly filled array share the same storage. The unused tail of the last chunk is always
+    // value initialized, so whole chunks can be hashed and compared.
+    persistent_array(std::size_t size, const T &value) : _size(size) {
+        auto chunk = std::make_shared<chunk_t>();
+        chunk->values.fill(value);
+        _chunks.assign(size / ChunkSize, chunk);
+        if (size % ChunkSize != 0) {
+            auto tail = std::make_shared<chunk_t>();
+            std::fill(tail->values.begin(), tail->values.begin() + size % ChunkSize, value);
+            _chunks.push_back(tail);
+        }
+    }
+
+    std::size_t size() const { return _size; }
+
+    const T &operator[](std::size_t index) const {
+        return _chunks[index / ChunkSize]->values[index % ChunkSize];
+    }
+
+    // Mutable access writes through set(), see reference.
+    reference operator[](std::size_t index) {
+        return reference{this, index};
+    }
+
+    // Writes an element, copying the chunk holding it if it is shared and clearing the cached hash of the chunk.
+    void set(std::size_t index, const T &value) {
+        writable(index).values[index % ChunkSize] = value;
+    }
+
+    const_iterator begin() const { return const_iterator{this, 0}; }
+
+    const_iterator end() const { return const_iterator{this, _size}; }
+
+    // Number of chunks shared with another array, used to inspect how much storage successors share.
+    std::size_t sharedChunks(const persistent_array &other) const {
+        std::size_t result = 0;
+        for (std::size_t i = 0; i < _chunks.size() && i < other._chunks.size(); ++i) {
+            result += _chunks[i] == other._chunks[i];
+        }
+        return result;
+    }
+
+    std::size_t hash() const {
+        std::size_t result = _size;
+        for (auto &chunk: _chunks) {
+            result ^= chunkHash(*chunk) + 0x9e3779b97f4a7c15ULL + (result << 6) + (result >> 2);
+        }
+        return result;
+    }
+
+    bool operator==(const persistent_array &other) const {
+        if (_size != other._size)
+            return false;
+        for (std::size_t i = 0; i < _chunks.size(); ++i) {
+            auto &a = _chunks[i];
+            auto &b = other._chunks[i];
+            if (a == b)
+                continue; // shared chunks are equal without looking at them
+            auto hashA = a->hash.load(std::memory_order_relaxed);
+            auto hashB = b->hash.load(std::memory_order_relaxed);
+            if ((hashA != 0 && hashB != 0 && hashA != hashB) || a->values != b->values)
+                return false;
+        }
+        return true;
+    }
+
+    bool operator!=(const persistent_array &other) const {
+        return !(*this == other);
+    }
+};
+
+namespace std {
+    template<class T, std::size_t ChunkSize>
+    struct hash<persistent_array<T, ChunkSize>> {
+        std::size_t operator()(const persistent_array<T, ChunkSize> &array) const {
+            return array.hash();
+        }
+    };
+}
+
+// Default hashing of states. Uses std::hash when the state type has one, otherwise combines the hashes of the
+// elements of iterable states (vectors, arrays) and finally hashes the bytes of plain structs without padding.
+// States with an operator== that ignores some members must supply their own hash type to state_space_t.
+namespace reachability_detail {
+    template<std::size_t N>
+    struct priority : priority<N - 1> {
+    };
+
+    template<>
+    struct priority<0> {
+    };
+
+    // Keeps a parameter out of class template argument deduction, as std::type_identity of C++20.
+    template<class T>
+    struct identity {
+        using type = T;
+    };
+
+    // Finalizer of splitmix64, spreads the entropy of a hash over all bits.
+    inline std::uint64_t mix(std::uint64_t h) {
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebULL;
+        return h ^ (h >> 31);
+    }
+
+    inline std::uint64_t combine(std::uint64_t seed, std::uint64_t value) {
+        return mix(seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+    }
+
+    inline std::uint64_t hash_bytes(const void *data, std::size_t size) {
+        auto bytes = static_cast<const unsigned char *>(data);
+        std::uint64_t result = size;
+        std::uint64_t word;
+        for (; size >= sizeof(word); size -= sizeof(word), bytes += sizeof(word)) {
+            std::memcpy(&word, bytes, sizeof(word));
+            result = combine(result, word);
+        }
+        if (size > 0) {
+            word = 0;
+            std::memcpy(&word, bytes, size);
+            result = combine(result, word);
+        }
+        return result;
+    }
+
+    template<class T>
+    auto hash_value(const T &value, priority<2>) -> decltype(std::hash<T>{}(value)) {
+        return std::hash<T>{}(value);
+    }
+
+    template<class T>
+    auto hash_value(const T &value, priority<1>) -> decltype(std::begin(value), std::end(value), std::size_t{}) {
+        std::uint64_t result = 0;
+        for (auto &element: value) {
+            result = combine(result, hash_value(element, priority<2>{}));
+        }
+        return result;
+    }
+
+    template<class T>
+    auto hash_value(const T &value, priority<0>)
+    -> std::enable_if_t<std::has_unique_object_representations<T>::value, std::size_t> {
+        return hash_bytes(&value, sizeof(T));
+    }
+}
+
+template<class StateT>
+struct state_hash {
+    std::size_t operator()(const StateT &state) const {
+        return reachability_detail::hash_value(state, reachability_detail::priority<2>{});
+    }
+};
+
+// Hash and equality kernels for packed states, i.e. padding-free trivially copyable states or contiguous containers of
+// such elements, which are processed as plain bytes. The kernel is chosen through the hash trait (see packed_hash)
+// and the vectorised kernels are only used when the running CPU supports them.
+enum class hash_kernel {
+    automatic, // wyhash for small states, avx2 for large states when the running CPU supports it
+    wyhash,    // portable 64-bit multiply-mix
+    crc32,     // SSE4.2 CRC32 instructions over two independent lanes
+    avx2       // AVX2 multiply-mix over four 64-bit lanes and AVX2 equality
+};
+
+namespace reachability_detail {
+    __extension__ typedef unsigned __int128 uint128_t;
+
+    inline std::uint64_t read64(const unsigned char *p) {
+        std::uint64_t result;
+        std::memcpy(&result, p, sizeof(result));
+        return result;
+    }
+
+    inline std::uint64_t read32(const unsigned char *p) {
+        std::uint32_t result;
+        std::memcpy(&result, p, sizeof(result));
+        return result;
+    }
+
+    // Folds the 128-bit product of two words.
+    inline std::uint64_t mum(std::uint64_t a, std::uint64_t b) {
+        auto product = static_cast<uint128_t>(a) * b;
+        return static_cast<std::uint64_t>(product) ^ static_cast<std::uint64_t>(product >> 64);
+    }
+
+    constexpr std::uint64_t wy_secret0 = 0xa0761d6478bd642fULL;
+    constexpr std::uint64_t wy_secret1 = 0xe7037ed1a0b428dbULL;
+
+    inline std::uint64_t hash_wyhash(const void *data, std::size_t size) {
+        auto p = static_cast<const unsigned char *>(data);
+        std::uint64_t seed = wy_secret0, a, b;
+        if (size <= 16) {
+            if (size >= 4) {
+                a = (read32(p) << 32) | read32(p + ((size >> 3) << 2));
+                b = (read32(p + size - 4) << 32) | read32(p + size - 4 - ((size >> 3) << 2));
+            } else if (size > 0) {
+                a = (std::uint64_t{p[0]} << 16) | (std::uint64_t{p[size >> 1]} << 8) | p[size - 1];
+                b = 0;
+            } else {
+                a = b = 0;
+            }
+        } else {
+            auto remaining = size;
+            for (; remaining > 16; remaining -= 16, p += 16) {
+                seed = mum(read64(p) ^ wy_secret1, read64(p + 8) ^ seed);
+            }
+            a = read64(p + remaining - 16);
+            b = read64(p + remaining - 8);
+        }
+        return mum(wy_secret1 ^ size, mum(a ^ wy_secret1, b ^ seed));
+    }
+
+    inline bool equal_bytes(const void *a, const void *b, std::size_t size) {
+        return std::memcmp(a, b, size) == 0;
+    }
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define PUZZLEENGINE_X86_KERNELS
+
+    // Two independent CRC lanes over alternating words halve the dependency chain of the CRC instruction.
+    __attribute__((target("sse4.2")))
+    inline std::uint64_t hash_crc32(const void *data, std::size_t size) {
+        auto p = static_cast<const unsigned char *>(data);
+        std::uint64_t a = 0x243f6a88, b = 0x85a308d3;
+        auto remaining = size;
+        for (; remaining >= 16; remaining -= 16, p += 16) {
+            a = _mm_crc32_u64(a, read64(p));
+            b = _mm_crc32_u64(b, read64(p + 8));
+        }
+        if (remaining >= 8) {
+            a = _mm_crc32_u64(a, read64(p));
+            remaining -= 8, p += 8;
+        }
+        if (remaining > 0) {
+            std::uint64_t word = 0;
+            std::memcpy(&word, p, remaining);
+            b = _mm_crc32_u64(b, word);
+        }
+        return mum(a ^ wy_secret0 ^ size, b ^ wy_secret1);
+    }
+
+    // XXH3 style accumulation: every 32 byte block is keyed and multiplied lane by lane, the tail is zero padded.
+    __attribute__((target("avx2")))
+    inline std::uint64_t hash_avx2(const void *data, std::size_t size) {
+        auto p = static_cast<const unsigned char *>(data);
+        const auto key = _mm256_set_epi64x(0x1f67b3b7a4a44072LL, 0x78e5c0cc4ee679cbLL,
+                                           0x2172ffcc7dd05a82LL, 0x7c01812cf721ad1cLL);
+        auto acc = _mm256_set1_epi64x(static_cast<long long>(size));
+        alignas(32) unsigned char tail[32] = {};
+        for (auto remaining = size; remaining > 0; remaining -= std::min<std::size_t>(remaining, 32), p += 32) {
+            if (remaining < 32) {
+                std::memcpy(tail, p, remaining);
+                p = tail;
+            }
+            auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+            auto keyed = _mm256_xor_si256(block, key);
+            auto product = _mm256_mul_epu32(keyed, _mm256_srli_epi64(keyed, 32));
+            acc = _mm256_add_epi64(acc, _mm256_add_epi64(product, _mm256_shuffle_epi32(block, 0x4e)));
+        }
+        alignas(32) std::uint64_t lanes[4];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), acc);
+        return mum(lanes[0] ^ wy_secret0, lanes[1] ^ wy_secret1) ^ mum(lanes[2] ^ wy_secret1, lanes[3] ^ wy_secret0);
+    }
+
+    __attribute__((target("avx2")))
+    inline bool equal_avx2(const void *a, const void *b, std::size_t size) {
+        auto p = static_cast<const unsigned char *>(a);
+        auto q = static_cast<const unsigned char *>(b);
+        for (; size >= 32; size -= 32, p += 32, q += 32) {
+            auto equal = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)),
+                                           _mm256_loadu_si256(reinterpret_cast<const __m256i *>(q)));
+            if (_mm256_movemask_epi8(equal) != -1)
+                return false;
+        }
+        if (size >= 16) {
+            auto equal = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)),
+                                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(q)));
+            if (_mm_movemask_epi8(equal) != 0xffff)
+                return false;
+            size -= 16, p += 16, q += 16;
+        }
+        return std::memcmp(p, q, size) == 0;
+    }
+#endif
+
+    using hash_kernel_f = std::uint64_t (*)(const void *, std::size_t);
+    using equal_kernel_f = bool (*)(const void *, const void *, std::size_t);
+
+    // Resolves a kernel against the features of the running CPU, falling back to the portable kernels. Equality uses
+    // memcmp unless AVX2 is requested, as the C library already picks a vectorised memcmp at load time.
+    inline std::pair<hash_kernel_f, equal_kernel_f> resolve_kernel(hash_kernel kernel) {
+#ifdef PUZZLEENGINE_X86_KERNELS
+        __builtin_cpu_init();
+        if (kernel == hash_kernel::crc32 && __builtin_cpu_supports("sse4.2"))
+            return {&hash_crc32, &equal_bytes};
+        if (kernel == hash_kernel::avx2 && __builtin_cpu_supports("avx2"))
+            return {&hash_avx2, &equal_avx2};
+        if (kernel == hash_kernel::automatic && __builtin_cpu_supports("avx2"))
+            return {&hash_avx2, &equal_bytes};
+#endif
+        return {&hash_wyhash, &equal_bytes};
+    }
+
+    template<hash_kernel Kernel>
+    const std::pair<hash_kernel_f, equal_kernel_f> &kernel() {
+        static const auto resolved = resolve_kernel(Kernel);
+        return resolved;
+    }
+
+    // Below this size the call through a dispatched kernel costs more than the portable kernel inlined.
+    constexpr std::size_t large_packed_state = 256;
+
+    // The bytes of a packed state: the object itself or the elements of a contiguous container.
+    template<class T>
+    auto packed_bytes(const T &value, priority<1>) -> decltype(value.data(), value.size(),
+            std::pair<const void *, std::size_t>{}) {
+        using element_t = std::remove_cv_t<std::remove_reference_t<decltype(*value.data())>>;
+        static_assert(std::has_unique_object_representations<element_t>::value,
+                      "Elements of a packed state must be trivially copyable without padding.");
+        return {value.data(), value.size() * sizeof(element_t)};
+    }
+
+    template<class T>
+    std::pair<const void *, std::size_t> packed_bytes(const T &value, priority<0>) {
+        static_assert(std::has_unique_object_representations<T>::value,
+                      "A packed state must be trivially copyable without padding.");
+        return {&value, sizeof(T)};
+    }
+
+    // Uses the equality of the hash trait when it has one, otherwise operator==.
+    template<class HashT, class StateT>
+    auto states_equal(const HashT &hash, const StateT &a, const StateT &b, priority<1>) -> decltype(hash.equal(a, b)) {
+        return hash.equal(a, b);
+    }
+
+    template<class HashT, class StateT>
+    bool states_equal(const HashT &, const StateT &a, const StateT &b, priority<0>) {
+        return a == b;
+    }
 }
 
-// Struct to save the current trace.
-template<class StateT>
-struct trace_state {
-    std::shared_ptr<trace_state> parent = nullptr;
-    StateT self;
-};
+// Hash trait for packed states using the given kernel, it also provides the matching equality kernel. Select it for
+// a state type by deriving the state_hash specialisation from it or by passing it to state_space_t.
+template<class StateT, hash_kernel Kernel = hash_kernel::automatic>
+struct packed_hash {
+    std::size_t operator()(const StateT &state) const {
+        auto bytes = reachability_detail::packed_bytes(state, reachability_detail::priority<1>{});
+        if (Kernel == hash_kernel::wyhash ||
+            (Kernel == hash_kernel::automatic && bytes.second < reachability_detail::large_packed_state)) {
+            return reachability_detail::hash_wyhash(bytes.first, bytes.second);
+        }
+        return reachability_detail::kernel<Kernel>().first(bytes.first, bytes.second);
+    }
+
+    bool equal(const StateT &a, const StateT &b) const {
+        auto bytesA = reachability_detail::packed_bytes(a, reachability_detail::priority<1>{});
+        auto bytesB = reachability_detail::packed_bytes(b, reachability_detail::priority<1>{});
+        if (bytesA.second != bytesB.second)
+            return false;
+        if (Kernel != hash_kernel::avx2) {
+            return reachability_detail::equal_bytes(bytesA.first, bytesB.first, bytesA.second);
+        }
+        return reachability_detail::kernel<Kernel>().second(bytesA.first, bytesB.first, bytesA.second);
+    }
+};
+
+namespace reachability_detail {
+    template<class T>
+    void put(std::vector<char> &out, const T &value) {
+        auto size = out.size();
+        out.resize(size + sizeof(T));
+        std::memcpy(out.data() + size, &value, sizeof(T));
+    }
+
+    template<class T>
+    const char *get(const char *data, T &value) {
+        std::memcpy(&value, data, sizeof(T));
+        return data + sizeof(T);
+    }
+
+    // Resizable containers are prefixed with their size in bytes, other packed values are their object bytes.
+    template<class T>
+    auto encode_packed(const T &value, std::vector<char> &out, priority<1>)
+            -> decltype(std::declval<T &>().resize(0), void()) {
+        auto bytes = packed_bytes(value, priority<1>{});
+        put(out, static_cast<std::uint32_t>(bytes.second));
+        auto first = static_cast<const char *>(bytes.first);
+        out.insert(out.end(), first, first + bytes.second);
+    }
+
+    template<class T>
+    void encode_packed(const T &value, std::vector<char> &out, priority<0>) {
+        auto bytes = packed_bytes(value, priority<1>{});
+        auto first = static_cast<const char *>(bytes.first);
+        out.insert(out.end(), first, first + bytes.second);
+    }
+
+    template<class T>
+    auto decode_packed(const char *data, T &value, priority<1>)
+            -> decltype(value.resize(0), static_cast<const char *>(data)) {
+        using element_t = std::remove_reference_t<decltype(*value.data())>;
+        std::uint32_t size;
+        data = get(data, size);
+        value.resize(size / sizeof(element_t));
+        std::memcpy(value.data(), data, size);
+        return data + size;
+    }
+
+    template<class T>
+    const char *decode_packed(const char *data, T &value, priority<0>) {
+        auto bytes = packed_bytes(value, priority<1>{});
+        std::memcpy(const_cast<void *>(bytes.first), data, bytes.second);
+        return data + bytes.second;
+    }
+}
+
+namespace reachability_detail {
+    // Whether a type is packed: trivially copyable without padding or a contiguous container of such.
+    template<class T, class = void>
+    struct is_packed : std::has_unique_object_representations<T> {
+    };
+
+    template<class T>
+    struct is_packed<T, std::void_t<decltype(std::declval<const T &>().data()), decltype(std::declval<const T &>().size())>>
+            : std::has_unique_object_representations<std::remove_cv_t<std::remove_reference_t<
+                    decltype(*std::declval<const T &>().data())>>> {
+    };
+}
+
+// Serialisation of states and costs into bytes, for the distributed and the sort-based searches. The default handles
+// packed types, so equal states always encode to the same bytes. Specialise it for other types.
+template<class T, class = void>
+struct state_codec {
+};
+
+template<class T>
+struct state_codec<T, std::enable_if_t<reachability_detail::is_packed<T>::value>> {
+    void encode(const T &value, std::vector<char> &out) const {
+        reachability_detail::encode_packed(value, out, reachability_detail::priority<1>{});
+    }
+
+    // Decodes a value and returns the position after it.
+    const char *decode(const char *data, T &value) const {
+        return reachability_detail::decode_packed(data, value, reachability_detail::priority<1>{});
+    }
+};
+
+namespace reachability_detail {
+    template<class T, class = void>
+    struct has_codec : std::false_type {
+    };
+
+    template<class T>
+    struct has_codec<T, std::void_t<decltype(std::declval<const state_codec<T> &>().encode(
+            std::declval<const T &>(), std::declval<std::vector<char> &>()))>> : std::true_type {
+    };
+}
+
+// Placement of the large engine tables (state pool slots, trace nodes). Tables of at least large_table_threshold
+// bytes are mapped directly with mmap: with hugePages they are aligned to and advised for transparent huge pages,
+// which cuts TLB misses on random probes, and with hugetlbfs explicit huge pages (MAP_HUGETLB) are tried first. The
+// latter needs huge pages reserved through /proc/sys/vm/nr_hugepages and is enabled by defining
+// PUZZLEENGINE_HUGETLBFS. Both fall back to ordinary pages when unavailable.
+struct large_table_policy {
+    static inline bool hugePages = true;
+#ifdef PUZZLEENGINE_HUGETLBFS
+    static inline bool hugetlbfs = true;
+#else
+    static inline bool hugetlbfs = false;
+#endif
+};
+
+constexpr std::size_t large_table_threshold = 1 << 20;
+
+// NUMA nodes of the machine and their CPUs as reported by /sys/devices/system/node. A machine without that
+// information is treated as a single node holding all CPUs, so parallel modes can always partition by node, see
+// reachability_detail::worker_pool_t.
+class numa_topology {
+public:
+    static const numa_topology &system() {
+        static const numa_topology topology;
+        return topology;
+    }
+
+    std::size_t nodes() const {
+        return _cpus.size();
+    }
+
+    const std::vector<int> &cpus(std::size_t node) const {
+        return _cpus[node];
+    }
+
+    // Pins the calling thread to the CPUs of a node, returns false if the operating system refused.
+    bool pinToNode(std::size_t node) const {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (auto cpu: _cpus[node % _cpus.size()]) {
+            CPU_SET(cpu, &set);
+        }
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+        return false;
+#endif
+    }
+
+    // The node of the CPU running the calling thread, or -1 on a machine of a single node.
+    int currentNode() const {
+#ifdef __linux__
+        if (_cpus.size() > 1) {
+            auto cpu = sched_getcpu();
+            for (std::size_t node = 0; node < _cpus.size(); ++node) {
+                if (std::find(_cpus[node].begin(), _cpus[node].end(), cpu) != _cpus[node].end())
+                    return static_cast<int>(node);
+            }
+        }
+#endif
+        return -1;
+    }
+
+private:
+    std::vector<std::vector<int>> _cpus;
+
+    numa_topology() {
+#ifdef __linux__
+        for (int node = 0;; ++node) {
+            std::ifstream list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if (!list)
+                break;
+            _cpus.push_back(parseCpuList(list));
+        }
+#endif
+        if (_cpus.empty()) {
+            _cpus.emplace_back();
+            for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) {
+                _cpus.back().push_back(static_cast<int>(cpu));
+            }
+        }
+    }
+
+    // Parses lists like "0-3,8-11".
+    static std::vector<int> parseCpuList(std::istream &list) {
+        std::vector<int> result;
+        int first, last;
+        while (list >> first) {
+            last = first;
+            if (list.peek() == '-') {
+                list.ignore();
+                list >> last;
+            }
+            for (auto cpu = first; cpu <= last; ++cpu) {
+                result.push_back(cpu);
+            }
+            if (list.peek() == ',') {
+                list.ignore();
+            }
+        }
+        return result;
+    }
+};
+
+namespace reachability_detail {
+    constexpr std::size_t huge_page_size = 2 << 20;
+
+    inline std::size_t table_bytes(std::size_t bytes) {
+        return (bytes + huge_page_size - 1) / huge_page_size * huge_page_size;
+    }
+
+    // Maps a table of table_bytes(bytes) bytes aligned to the huge page size, preferring the given NUMA node.
+    inline void *map_table(std::size_t bytes, int node) {
+#ifdef __linux__
+        bytes = table_bytes(bytes);
+        void *result = MAP_FAILED;
+        if (large_table_policy::hugetlbfs) {
+            result = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+        if (result == MAP_FAILED) {
+            // Over-allocate by one huge page and trim, so the table starts on a huge page boundary.
+            auto mapped = mmap(nullptr, bytes + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                               -1, 0);
+            if (mapped == MAP_FAILED)
+                throw std::bad_alloc();
+            auto start = reinterpret_cast<std::uintptr_t>(mapped);
+            auto aligned = (start + huge_page_size - 1) / huge_page_size * huge_page_size;
+            if (aligned > start)
+                munmap(mapped, aligned - start);
+            munmap(reinterpret_cast<void *>(aligned + bytes), start + huge_page_size - aligned);
+            result = reinterpret_cast<void *>(aligned);
+            madvise(result, bytes, large_table_policy::hugePages ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+        }
+        if (node >= 0) {
+            // MPOL_PREFERRED: allocate on the node while it has free memory. Fails harmlessly on single node kernels.
+            unsigned long mask[16] = {};
+            mask[node / (8 * sizeof(unsigned long)) % 16] |= 1UL << (node % (8 * sizeof(unsigned long)));
+            syscall(SYS_mbind, result, bytes, 1, mask, sizeof(mask) * 8, 0);
+        }
+        return result;
+#else
+        return ::operator new(bytes);
+#endif
+    }
+
+    inline void unmap_table(void *table, std::size_t bytes) {
+#ifdef __linux__
+        munmap(table, table_bytes(bytes));
+#else
+        ::operator delete(table);
+#endif
+    }
+}
+
+// Allocator for the large engine tables, small allocations go through the default allocator. A table can be bound
+// to a NUMA node, by default its pages are placed on the node of the thread touching them first.
+template<class T>
+class large_table_allocator {
+public:
+    using value_type = T;
+
+    large_table_allocator(int numaNode = -1) noexcept: _node(numaNode) {}
+
+    template<class U>
+    large_table_allocator(const large_table_allocator<U> &other) noexcept : _node(other.node()) {}
+
+    T *allocate(std::size_t n) {
+        if (n * sizeof(T) < large_table_threshold) {
+            return std::allocator<T>{}.allocate(n);
+        }
+        return static_cast<T *>(reachability_detail::map_table(n * sizeof(T), _node));
+    }
+
+    void deallocate(T *table, std::size_t n) {
+        if (n * sizeof(T) < large_table_threshold) {
+            std::allocator<T>{}.deallocate(table, n);
+        } else {
+            reachability_detail::unmap_table(table, n * sizeof(T));
+        }
+    }
+
+    int node() const {
+        return _node;
+    }
+
+    template<class U>
+    bool operator==(const large_table_allocator<U> &other) const {
+        return _node == other.node();
+    }
+
+    template<class U>
+    bool operator!=(const large_table_allocator<U> &other) const {
+        return _node != other.node();
+    }
+
+private:
+    int _node;
+};
+
+// Handle of a state interned in a state_pool_t.
+using state_id_t = std::uint32_t;
+
+// Interning pool holding every distinct state exactly once. States are stored in chunks that never move, so a
+// state_id_t stays valid and a reference to a pooled state is never invalidated by later insertions. Lookup goes
+// through an open addressing table of ids, which makes the pool the visited set of the search as well.
+template<class StateT, class HashT = state_hash<StateT>>
+class state_pool_t {
+public:
+    static constexpr state_id_t no_state = static_cast<state_id_t>(-1);
+
+    // The tables are placed on the given NUMA node, by default on the node touching them first.
+    explicit state_pool_t(HashT hash = HashT{}, int numaNode = -1)
+            : _hash(std::move(hash)), _numaNode(numaNode), _slots(large_table_allocator<slot_t>{numaNode}) {
+        _slots.assign(initial_slots, slot_t{no_state, 0});
+    }
+
+    // Returns the id of the state and whether the state was added by this call.
+    std::pair<state_id_t, bool> intern(const StateT &state) {
+        return insert(state, hashOf(state));
+    }
+
+    // Interns a block of states, storing their ids in ids. All hashes are computed first and the slots they map to
+    // are prefetched, so the cache misses of the whole block overlap instead of stalling one probe at a time.
+    void internBatch(const StateT *batch, std::size_t count, std::vector<state_id_t> &ids) {
+        _batchHashes.resize(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            _batchHashes[i] = hashOf(batch[i]);
+        }
+        internBatch(batch, _batchHashes.data(), count, ids);
+    }
+
+    // Interns a block of states whose hashes were computed elsewhere with hash(state).
+    void internBatch(const StateT *batch, const std::uint64_t *hashes, std::size_t count,
+                     std::vector<state_id_t> &ids) {
+        ids.resize(count);
+        auto mask = _slots.size() - 1;
+        for (std::size_t i = 0; i < count; ++i) {
+            prefetch(&_slots[hashes[i] & mask]);
+        }
+        // Prefetch the candidate states as well, a matching tag almost always means the state is already interned.
+        for (std::size_t i = 0; i < count; ++i) {
+            auto &entry = _slots[hashes[i] & mask];
+            if (entry.id != no_state && entry.tag == tagOf(hashes[i])) {
+                prefetch(&(*this)[entry.id]);
+            }
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            ids[i] = insert(batch[i], hashes[i]).first;
+        }
+    }
+
+    // Returns the id of an interned state or no_state.
+    state_id_t find(const StateT &state) const {
+        return _slots[probe(state, hashOf(state))].id;
+    }
+
+    // The hash of a state as used by the pool, for callers which need it before interning, see shared_graph_t.
+    std::uint64_t hash(const StateT &state) const {
+        return hashOf(state);
+    }
+
+    std::pair<state_id_t, bool> intern(const StateT &state, std::uint64_t hash) {
+        return insert(state, hash);
+    }
+
+    state_id_t find(const StateT &state, std::uint64_t hash) const {
+        return _slots[probe(state, hash)].id;
+    }
+
+    // Whether the state of an id equals a state, compared as the pool compares them.
+    bool holds(state_id_t id, const StateT &state) const {
+        return equal((*this)[id], state);
+    }
+
+    const StateT &operator[](state_id_t id) const {
+        return _chunks[id / chunk_size][id % chunk_size];
+    }
+
+    std::size_t size() const {
+        return _size;
+    }
+
+private:
+    // Chunks hold a power of two number of states and span at least one huge page.
+    static constexpr std::size_t chunk_size = [] {
+        std::size_t size = 4096;
+        while (size * sizeof(StateT) < reachability_detail::huge_page_size)
+            size *= 2;
+        return size;
+    }();
+    static constexpr std::size_t initial_slots = 1024;
+
+    // The tag holds the upper hash bits, which rules out most mismatches without touching the state.
+    struct slot_t {
+        state_id_t id;
+        std::uint32_t tag;
+    };
+
+    HashT _hash;
+    std::vector<std::vector<StateT, large_table_allocator<StateT>>> _chunks;
+    int _numaNode;
+    std::vector<slot_t, large_table_allocator<slot_t>> _slots;
+    std::size_t _size = 0;
+    std::vector<std::uint64_t> _batchHashes;
+
+    std::pair<state_id_t, bool> insert(const StateT &state, std::uint64_t hash) {
+        auto slot = probe(state, hash);
+        if (_slots[slot].id != no_state) {
+            return {_slots[slot].id, false};
+        }
+        if (_size == no_state) {
+            throw std::length_error("state pool exceeds 32-bit state ids");
+        }
+        if (_size % chunk_size == 0) {
+            _chunks.emplace_back(large_table_allocator<StateT>{_numaNode});
+            _chunks.back().reserve(chunk_size);
+        }
+        _chunks.back().push_back(state);
+        auto id = static_cast<state_id_t>(_size++);
+        _slots[slot] = slot_t{id, tagOf(hash)};
+        if (_size * 2 > _slots.size()) {
+            grow();
+        }
+        return {id, true};
+    }
+
+    static void prefetch(const void *address) {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(address);
+#endif
+    }
+
+    std::uint64_t hashOf(const StateT &state) const {
+        return reachability_detail::mix(_hash(state));
+    }
+
+    bool equal(const StateT &a, const StateT &b) const {
+        return reachability_detail::states_equal(_hash, a, b, reachability_detail::priority<1>{});
+    }
+
+    static std::uint32_t tagOf(std::uint64_t hash) {
+        return static_cast<std::uint32_t>(hash >> 32);
+    }
+
+    // Linear probing for the slot holding the state, or the empty slot where it belongs.
+    std::size_t probe(const StateT &state, std::uint64_t hash) const {
+        auto mask = _slots.size() - 1;
+        auto tag = tagOf(hash);
+        for (auto slot = hash & mask;; slot = (slot + 1) & mask) {
+            auto &entry = _slots[slot];
+            if (entry.id == no_state || (entry.tag == tag && equal((*this)[entry.id], state))) {
+                return slot;
+            }
+        }
+    }
+
+    void grow() {
+        std::vector<slot_t, large_table_allocator<slot_t>> slots(_slots.size() * 2, slot_t{no_state, 0},
+                                                                 _slots.get_allocator());
+        auto mask = slots.size() - 1;
+        for (auto &entry: _slots) {
+            if (entry.id == no_state)
+                continue;
+            auto slot = hashOf((*this)[entry.id]) & mask;
+            while (slots[slot].id != no_state) {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = entry;
+        }
+        _slots.swap(slots);
+    }
+};
+
+// Lookups and hits of the per-thread filters of rediscovered states, see shared_graph_t::filterStatistics and
+// state_space_t::filterStatistics.
+struct filter_statistics_t {
+    std::size_t lookups = 0;
+    std::size_t hits = 0;
+};
+
+// Explored graph of a state space shared by concurrent queries, see state_space_t::shareGraph. The states are interned
+// into shards chosen by their hash, each guarded by a reader-writer lock, and once a query has expanded a state its
+// successors satisfying the invariant are kept as ids. Later queries walk the kept successors instead of calling the
+// transition and invariant functions again, so the graph is explored once for all queries, and each query only holds
+// its own trace nodes and passed states. A state id holds its shard in the low bits and its index in the shard above.
+template<class StateT, class HashT = state_hash<StateT>>
+class shared_graph_t {
+public:
+    static constexpr std::size_t shard_bits = 4;
+    static constexpr std::size_t shards = std::size_t{1} << shard_bits;
+
+    // Direct-mapped cache of the states a thread interned last, see intern(state, filter). A thread expanding states
+    // mostly rediscovers states it has just seen, such as the state it came from, and finds them here without
+    // touching the locks and cache lines of the shards shared with the other threads. A slot points to the interned
+    // state, which never moves, and is only taken if that state equals the one looked up.
+    class filter_t {
+    public:
+        static constexpr std::size_t slots = 1024;
+
+        std::size_t lookups() const {
+            return _lookups;
+        }
+
+        std::size_t hits() const {
+            return _hits;
+        }
+
+    private:
+        friend class shared_graph_t;
+
+        struct slot_t {
+            std::uint64_t hash = 0;
+            const StateT *state = nullptr;
+            state_id_t id = 0;
+        };
+
+        std::vector<slot_t> _slots = std::vector<slot_t>(slots);
+        std::size_t _lookups = 0;
+        std::size_t _hits = 0;
+    };
+
+    // Returns the id of the state and whether the state was added by this call. Interned states are looked up under
+    // the shared lock of their shard, so only new states take it exclusively.
+    std::pair<state_id_t, bool> intern(const StateT &state) {
+        auto hash = _shards[0].pool.hash(state);
+        auto result = insert(state, hash);
+        return {result.id, result.added};
+    }
+
+    // Interns a state as intern(state), looking in the filter of the calling thread first.
+    std::pair<state_id_t, bool> intern(const StateT &state, filter_t &filter) {
+        auto hash = _shards[0].pool.hash(state);
+        auto &slot = filter._slots[hash & (filter_t::slots - 1)];
+        ++filter._lookups;
+        if (slot.state && slot.hash == hash &&
+            reachability_detail::states_equal(_hash, *slot.state, state, reachability_detail::priority<1>{})) {
+            ++filter._hits;
+            return {slot.id, false};
+        }
+        auto result = insert(state, hash);
+        slot = typename filter_t::slot_t{hash, result.state, result.id};
+        return {result.id, result.added};
+    }
+
+    // Adds the lookups and hits of a filter to the statistics of the graph, called once by a query when it finishes.
+    // The statistics are those of all finished queries.
+    void filtered(const filter_t &filter) {
+        _lookups += filter.lookups();
+        _hits += filter.hits();
+    }
+
+    filter_statistics_t filterStatistics() const {
+        return filter_statistics_t{_lookups.load(), _hits.load()};
+    }
+
+    // A reference to a state stays valid, as the pools never move their states.
+    const StateT &operator[](state_id_t id) const {
+        auto &shard = _shards[id & (shards - 1)];
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        return shard.pool[id >> shard_bits];
+    }
+
+    // Copies the kept successors of a state and returns true, or returns false if no query has expanded it yet.
+    bool successors(state_id_t id, std::vector<state_id_t> &successors) const {
+        auto &shard = _shards[id & (shards - 1)];
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto &entry = shard.entries[id >> shard_bits];
+        if (!entry.expanded)
+            return false;
+        successors = entry.successors;
+        return true;
+    }
+
+    // Keeps the successors of an expanded state. Queries expanding a state at once find the same successors, the
+    // first to finish keeps them.
+    void expanded(state_id_t id, const std::vector<state_id_t> &successors) {
+        auto &shard = _shards[id & (shards - 1)];
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto &entry = shard.entries[id >> shard_bits];
+        if (!entry.expanded) {
+            entry.successors = successors;
+            entry.expanded = true;
+        }
+    }
+
+    // The number of interned states.
+    std::size_t size() const {
+        std::size_t result = 0;
+        for (auto &shard: _shards) {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            result += shard.pool.size();
+        }
+        return result;
+    }
+
+private:
+    struct entry_t {
+        bool expanded = false;
+        std::vector<state_id_t> successors;
+    };
+
+    // Entries are kept in a deque, which keeps them in place as the shard grows.
+    struct shard_t {
+        mutable std::shared_mutex mutex;
+        state_pool_t<StateT, HashT> pool;
+        std::deque<entry_t> entries;
+    };
+
+    struct inserted_t {
+        state_id_t id;
+        bool added;
+        const StateT *state;
+    };
+
+    std::array<shard_t, shards> _shards;
+    HashT _hash;
+    std::atomic<std::size_t> _lookups{0};
+    std::atomic<std::size_t> _hits{0};
+
+    inserted_t insert(const StateT &state, std::uint64_t hash) {
+        auto index = static_cast<std::size_t>(hash >> (64 - shard_bits));
+        auto &shard = _shards[index];
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            auto local = shard.pool.find(state, hash);
+            if (local != state_pool_t<StateT, HashT>::no_state)
+                return {id(local, index), false, &shard.pool[local]};
+        }
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto result = shard.pool.intern(state, hash);
+        if (result.second) {
+            if (result.first >> (32 - shard_bits)) {
+                throw std::length_error("shared graph exceeds 32-bit state ids");
+            }
+            shard.entries.emplace_back();
+        }
+        return {id(result.first, index), result.second, &shard.pool[result.first]};
+    }
+
+    static state_id_t id(state_id_t local, std::size_t shard) {
+        return local << shard_bits | static_cast<state_id_t>(shard);
+    }
+};
+
+// Store of all generated trace nodes. A node refers to its interned state and to the node it was generated from, so
+// a state reached along several paths is stored once while each path is kept.
+class trace_store_t {
+public:
+    using node_t = std::uint32_t;
+    static constexpr node_t no_parent = static_cast<node_t>(-1);
+
+    explicit trace_store_t(int numaNode = -1) : _nodes(large_table_allocator<node_state>{numaNode}) {}
+
+    node_t add(node_t parent, state_id_t state) {
+        if (_nodes.size() == no_parent) {
+            throw std::length_error("trace store exceeds 32-bit node ids");
+        }
+        _nodes.push_back(node_state{parent, state});
+        return static_cast<node_t>(_nodes.size() - 1);
+    }
+
+    state_id_t state(node_t node) const {
+        return _nodes[node].state;
+    }
+
+    node_t parent(node_t node) const {
+        return _nodes[node].parent;
+    }
+
+    std::size_t size() const {
+        return _nodes.size();
+    }
+
+    // Reconstructs the sequence of states from the initial state to the given node, states is a state_pool_t or a
+    // shared_graph_t.
+    template<template<class...> class ContainerT, class StatesT>
+    auto trace(node_t node, const StatesT &states) const {
+        std::vector<state_id_t> path;
+        for (; node != no_parent; node = _nodes[node].parent) {
+            path.push_back(_nodes[node].state);
+        }
+        ContainerT<std::decay_t<decltype(states[0])>> result;
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            result.push_back(states[*it]);
+        }
+        return result;
+    }
+
+private:
+    struct node_state {
+        node_t parent;
+        state_id_t state;
+    };
+
+    std::vector<node_state, large_table_allocator<node_state>> _nodes;
+};
+
+// Spilling of the waiting frontier to disk, for searches whose frontier exceeds memory. With memoryBlocks set, a
+// frontier keeps at most that many compressed blocks in memory and writes further blocks to an unlinked file in
+// directory. Blocks are written behind the search and read ahead of it, so popping in breadth-first order finds the
+// next blocks already loaded. The file is read and written with io_uring where the kernel provides it, otherwise by
+// a thread calling pread and pwrite. Spilling is only available on Linux.
+struct spill_policy {
+    // Compressed blocks of 4096 nodes kept in memory, 0 never spills.
+    static inline std::size_t memoryBlocks = 0;
+    // Spilled blocks read ahead of the front of the frontier.
+    static inline std::size_t readAhead = 4;
+    // Directory of the spill files, an empty one uses TMPDIR or /tmp.
+    static inline std::string directory;
+    // Disable to always use the thread backend.
+    static inline bool uring = true;
+};
+
+#ifdef __linux__
+namespace reachability_detail {
+    // An unlinked temporary file with asynchronous reads and writes. Every request returns a ticket to wait for, and
+    // the buffer of a request must stay untouched until then.
+    class spill_file_t {
+    public:
+        using ticket_t = std::uint64_t;
+
+        spill_file_t() {
+            auto directory = spill_policy::directory;
+            if (directory.empty()) {
+                auto temporary = std::getenv("TMPDIR");
+                directory = temporary && *temporary ? temporary : "/tmp";
+            }
+            auto name = directory + "/puzzleengine-spill-XXXXXX";
+            _fd = ::mkstemp(name.data());
+            if (_fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "cannot create spill file in " + directory);
+            }
+            ::unlink(name.c_str());
+#ifdef PUZZLEENGINE_IO_URING
+            if (spill_policy::uring)
+                setupRing();
+#endif
+            if (_ring < 0) {
+                _worker = std::thread([this] { work(); });
+            }
+        }
+
+        spill_file_t(const spill_file_t &) = delete;
+        spill_file_t &operator=(const spill_file_t &) = delete;
+
+        ~spill_file_t() {
+            if (_ring >= 0) {
+                while (!_requests.empty()) {
+                    enter(0, 1);
+                    reap();
+                }
+                ::munmap(_sqes, _sqesSize);
+                ::munmap(_sqRing, _sqRingSize);
+                if (_cqRing != _sqRing)
+                    ::munmap(_cqRing, _cqRingSize);
+                ::close(_ring);
+            } else {
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _stopping = true;
+                }
+                _wake.notify_all();
+                _worker.join();
+            }
+            ::close(_fd);
+        }
+
+        // Whether the requests go through io_uring.
+        bool uring() const {
+            return _ring >= 0;
+        }
+
+        ticket_t write(const void *data, std::size_t size, std::uint64_t offset) {
+            return submit(request_t{true, static_cast<char *>(const_cast<void *>(data)), size, offset});
+        }
+
+        ticket_t read(void *data, std::size_t size, std::uint64_t offset) {
+            return submit(request_t{false, static_cast<char *>(data), size, offset});
+        }
+
+        // Reserves bytes of the file, reusing the space of released extents before growing the file.
+        std::uint64_t allocate(std::uint64_t bytes) {
+            auto fit = _freeBySize.lower_bound({bytes, 0});
+            if (fit == _freeBySize.end()) {
+                auto offset = _end;
+                _end += bytes;
+                _size = std::max(_size, _end);
+                return offset;
+            }
+            auto [size, offset] = *fit;
+            _freeBySize.erase(fit);
+            _freeByOffset.erase(offset);
+            if (size > bytes) {
+                _freeByOffset.emplace(offset + bytes, size - bytes);
+                _freeBySize.emplace(size - bytes, offset + bytes);
+            }
+            return offset;
+        }
+
+        // Returns an extent once no request uses it, merging it with the free extents next to it.
+        void release(std::uint64_t offset, std::uint64_t bytes) {
+            auto next = _freeByOffset.lower_bound(offset);
+            if (next != _freeByOffset.end() && next->first == offset + bytes) {
+                bytes += next->second;
+                _freeBySize.erase({next->second, next->first});
+                next = _freeByOffset.erase(next);
+            }
+            if (next != _freeByOffset.begin()) {
+                auto previous = std::prev(next);
+                if (previous->first + previous->second == offset) {
+                    offset = previous->first;
+                    bytes += previous->second;
+                    _freeBySize.erase({previous->second, previous->first});
+                    _freeByOffset.erase(previous);
+                }
+            }
+            if (offset + bytes == _end) {
+                _end = offset;
+            } else {
+                _freeByOffset.emplace(offset, bytes);
+                _freeBySize.emplace(bytes, offset);
+            }
+        }
+
+        // The largest size the file has reached.
+        std::uint64_t size() const {
+            return _size;
+        }
+
+        // Waits until the request of the ticket is complete, a failed request throws.
+        void wait(ticket_t ticket) {
+            if (_ring >= 0) {
+                reap();
+                while (_requests.count(ticket)) {
+                    enter(0, 1);
+                    reap();
+                }
+                check();
+            } else {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _done.wait(lock, [&] { return !_requests.count(ticket); });
+                check();
+            }
+        }
+
+    private:
+        struct request_t {
+            bool write;
+            char *data;
+            std::size_t size;
+            std::uint64_t offset;
+        };
+
+        int _fd = -1;
+        ticket_t _next = 0;
+        std::unordered_map<ticket_t, request_t> _requests;
+        int _error = 0;
+        // The end of the extents in use, and the free extents below it by offset and by size.
+        std::uint64_t _end = 0, _size = 0;
+        std::map<std::uint64_t, std::uint64_t> _freeByOffset;
+        std::set<std::pair<std::uint64_t, std::uint64_t>> _freeBySize;
+
+        // The thread backend.
+        std::thread _worker;
+        std::mutex _mutex;
+        std::condition_variable _wake, _done;
+        std::deque<ticket_t> _queue;
+        bool _stopping = false;
+
+        // The io_uring backend, set up with the raw system calls.
+        int _ring = -1;
+        void *_sqRing = nullptr, *_cqRing = nullptr, *_sqes = nullptr;
+        std::size_t _sqRingSize = 0, _cqRingSize = 0, _sqesSize = 0;
+        unsigned *_sqHead = nullptr, *_sqTail = nullptr, *_sqMask = nullptr, *_sqArray = nullptr;
+        unsigned *_cqHead = nullptr, *_cqTail = nullptr, *_cqMask = nullptr;
+        unsigned _entries = 0;
+        void *_cqes = nullptr;
+
+        void check() const {
+            if (_error) {
+                throw std::system_error(_error, std::generic_category(), "spill file");
+            }
+        }
+
+        ticket_t submit(request_t request) {
+            auto ticket = _next++;
+            if (_ring >= 0) {
+                _requests.emplace(ticket, request);
+                push(ticket, request);
+                enter(1, 0);
+            } else {
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _requests.emplace(ticket, request);
+                    _queue.push_back(ticket);
+                }
+                _wake.notify_one();
+            }
+            return ticket;
+        }
+
+        void work() {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (true) {
+                _wake.wait(lock, [this] { return _stopping || !_queue.empty(); });
+                if (_queue.empty())
+                    return;
+                auto ticket = _queue.front();
+                _queue.pop_front();
+                auto request = _requests.at(ticket);
+                lock.unlock();
+                auto error = 0;
+                for (std::size_t done = 0; done < request.size && !error;) {
+                    auto result = request.write
+                                  ? ::pwrite(_fd, request.data + done, request.size - done,
+                                             static_cast<off_t>(request.offset + done))
+                                  : ::pread(_fd, request.data + done, request.size - done,
+                                            static_cast<off_t>(request.offset + done));
+                    if (result > 0)
+                        done += static_cast<std::size_t>(result);
+                    else if (result == 0)
+                        error = EIO;
+                    else if (errno != EINTR)
+                        error = errno;
+                }
+                lock.lock();
+                if (error && !_error)
+                    _error = error;
+                _requests.erase(ticket);
+                _done.notify_all();
+            }
+        }
+
+#ifdef PUZZLEENGINE_IO_URING
+        void setupRing() {
+            io_uring_params params{};
+            auto ring = static_cast<int>(::syscall(__NR_io_uring_setup, 64, &params));
+            if (ring < 0)
+                return;
+            // Reads and writes at an offset need the kernel which also reports IORING_FEAT_RW_CUR_POS.
+            if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+                ::close(ring);
+                return;
+            }
+            _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            if (params.features & IORING_FEAT_SINGLE_MMAP)
+                _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+            _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+            auto map = [ring](std::size_t size, off_t offset) {
+                return ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, offset);
+            };
+            _sqRing = map(_sqRingSize, IORING_OFF_SQ_RING);
+            _cqRing = params.features & IORING_FEAT_SINGLE_MMAP ? _sqRing : map(_cqRingSize, IORING_OFF_CQ_RING);
+            _sqes = map(_sqesSize, IORING_OFF_SQES);
+            if (_sqRing == MAP_FAILED || _cqRing == MAP_FAILED || _sqes == MAP_FAILED) {
+                for (auto mapping: {std::make_pair(_sqRing, _sqRingSize), std::make_pair(_cqRing, _cqRingSize),
+                                    std::make_pair(_sqes, _sqesSize)}) {
+                    if (mapping.first != MAP_FAILED && (mapping.first != _cqRing || _cqRing != _sqRing))
+                        ::munmap(mapping.first, mapping.second);
+                }
+                ::close(ring);
+                return;
+            }
+            auto field = [](void *base, unsigned offset) {
+                return reinterpret_cast<unsigned *>(static_cast<char *>(base) + offset);
+            };
+            _sqHead = field(_sqRing, params.sq_off.head);
+            _sqTail = field(_sqRing, params.sq_off.tail);
+            _sqMask = field(_sqRing, params.sq_off.ring_mask);
+            _sqArray = field(_sqRing, params.sq_off.array);
+            _cqHead = field(_cqRing, params.cq_off.head);
+            _cqTail = field(_cqRing, params.cq_off.tail);
+            _cqMask = field(_cqRing, params.cq_off.ring_mask);
+            _cqes = static_cast<char *>(_cqRing) + params.cq_off.cqes;
+            _entries = params.sq_entries;
+            _ring = ring;
+        }
+
+        // Queues a request, the ring holds at most _entries requests in flight.
+        void push(ticket_t ticket, const request_t &request) {
+            while (_requests.size() > _entries) {
+                enter(0, 1);
+                reap();
+            }
+            auto tail = *_sqTail;
+            auto index = tail & *_sqMask;
+            auto &entry = static_cast<io_uring_sqe *>(_sqes)[index];
+            std::memset(&entry, 0, sizeof(entry));
+            entry.opcode = request.write ? IORING_OP_WRITE : IORING_OP_READ;
+            entry.fd = _fd;
+            entry.addr = reinterpret_cast<std::uint64_t>(request.data);
+            entry.len = static_cast<std::uint32_t>(request.size);
+            entry.off = request.offset;
+            entry.user_data = ticket;
+            _sqArray[index] = index;
+            __atomic_store_n(_sqTail, tail + 1, __ATOMIC_RELEASE);
+        }
+
+        // Takes the completed requests off the ring, a partial transfer is queued again for the rest. Queueing and
+        // entering the ring may reap in turn, so the head is read from the ring for every completion and the partial
+        // transfers are only queued once all completions are taken.
+        void reap() {
+            std::vector<ticket_t> partial;
+            for (auto head = *_cqHead; head != __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE); head = *_cqHead) {
+                auto &completion = static_cast<io_uring_cqe *>(_cqes)[head & *_cqMask];
+                auto ticket = completion.user_data;
+                auto result = completion.res;
+                __atomic_store_n(_cqHead, head + 1, __ATOMIC_RELEASE);
+                auto &request = _requests.at(ticket);
+                if (result > 0 && static_cast<std::size_t>(result) < request.size) {
+                    request.data += result;
+                    request.size -= static_cast<std::size_t>(result);
+                    request.offset += static_cast<std::uint64_t>(result);
+                    partial.push_back(ticket);
+                    continue;
+                }
+                if (result <= 0 && !_error)
+                    _error = result < 0 ? -result : EIO;
+                _requests.erase(ticket);
+            }
+            for (auto ticket: partial) {
+                push(ticket, _requests.at(ticket));
+            }
+            if (!partial.empty())
+                enter(static_cast<unsigned>(partial.size()), 0);
+        }
+#else
+        void push(ticket_t, const request_t &) {}
+
+        void reap() {}
+#endif
+
+        void enter(unsigned submit, unsigned complete) {
+#ifdef PUZZLEENGINE_IO_URING
+            auto flags = complete ? IORING_ENTER_GETEVENTS : 0u;
+            while (::syscall(__NR_io_uring_enter, _ring, submit, complete, flags, nullptr, 0) < 0) {
+                if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                    throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+                if (errno != EINTR)
+                    reap();
+            }
+#else
+            (void) submit;
+            (void) complete;
+#endif
+        }
+    };
+}
+#endif
+
+// The waiting trace nodes of a search, stored as compressed blocks. Trace nodes are numbered in the order they are
+// generated, so consecutive waiting nodes differ by small amounts, and a block stores those differences as zigzag
+// varints, mostly a byte per node instead of the node and two list links. Only the nodes at either end are kept
+// decoded, and a block is decoded when popping reaches it: from the front for breadth-first search and from the back
+// for depth-first search. Blocks beyond spill_policy::memoryBlocks are spilled to disk, those popped last: the newest
+// when popping from the front and the oldest when popping from the back. The buffers of decoded and written blocks
+// are recycled for the next blocks, so a steady search in memory allocates no memory for its frontier.
+class frontier_blocks_t {
+public:
+    using node_t = trace_store_t::node_t;
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    std::size_t size() const {
+        return _head.size() - _headPosition + _blocks.size() * block_nodes + _tail.size();
+    }
+
+    // The bytes taken by the compressed blocks, the decoded ends and the spare buffers.
+    std::size_t memory() const {
+        auto bytes = (_head.capacity() + _tail.capacity()) * sizeof(node_t);
+        for (auto &block: _blocks) {
+            bytes += sizeof(block) + block.deltas.capacity();
+        }
+        for (auto &buffer: _spare) {
+            bytes += buffer.capacity();
+        }
+        return bytes;
+    }
+
+    // The bytes written to disk so far.
+    std::uint64_t spilled() const {
+        return _spilled;
+    }
+
+    // The largest size of the spill file, the space of blocks read back is reused.
+    std::uint64_t spillFile() const {
+#ifdef __linux__
+        return _file ? _file->size() : 0;
+#else
+        return 0;
+#endif
+    }
+
+    void push_back(node_t node) {
+        _tail.push_back(node);
+        if (_tail.size() == block_nodes) {
+            _blocks.push_back(encode(_tail));
+            _tail.clear();
+            ++_resident;
+#ifdef __linux__
+            if (spill_policy::memoryBlocks && _resident > spill_policy::memoryBlocks)
+                spill(_popsBack ? oldestResident() : _blocks.back());
+#endif
+        }
+    }
+
+    node_t front() {
+        _popsBack = false;
+        if (_headPosition == _head.size()) {
+            _head.clear();
+            _headPosition = 0;
+            if (!_blocks.empty()) {
+                take(_blocks.front(), _head);
+                _blocks.pop_front();
+                if (_firstResident)
+                    --_firstResident;
+#ifdef __linux__
+                readAhead();
+#endif
+            } else {
+                _head.swap(_tail);
+            }
+        }
+        return _head[_headPosition];
+    }
+
+    void pop_front() {
+        front();
+        ++_headPosition;
+    }
+
+    node_t back() {
+        _popsBack = true;
+        if (_tail.empty() && !_blocks.empty()) {
+            take(_blocks.back(), _tail);
+            _blocks.pop_back();
+            _firstResident = std::min(_firstResident, _blocks.size());
+#ifdef __linux__
+            readAhead();
+#endif
+        }
+        return _tail.empty() ? _head.back() : _tail.back();
+    }
+
+    void pop_back() {
+        back();
+        if (_tail.empty()) {
+            _head.pop_back();
+        } else {
+            _tail.pop_back();
+        }
+    }
+
+private:
+    static constexpr std::size_t block_nodes = 4096;
+    // Spilled blocks being written at once, the buffer of a block is released once its write completes.
+    static constexpr std::size_t write_behind = 2;
+    // Buffers kept for recycling, a search pushing and popping at the same pace needs one or two.
+    static constexpr std::size_t spare_buffers = 4;
+
+    enum class residence {
+        memory, writing, disk, reading
+    };
+
+    struct block_t {
+        node_t first;
+        std::vector<std::uint8_t> deltas;
+        residence where = residence::memory;
+        std::uint32_t bytes = 0;
+        std::uint64_t offset = 0;
+        std::uint64_t ticket = 0;
+    };
+
+    std::vector<node_t> _head;
+    std::size_t _headPosition = 0;
+    std::deque<block_t> _blocks;
+    std::vector<node_t> _tail;
+    std::vector<std::vector<std::uint8_t>> _spare;
+    // Blocks in memory which are not being written, and blocks with their deltas in the spill file.
+    std::size_t _resident = 0;
+    std::size_t _onDisk = 0;
+    std::uint64_t _spilled = 0;
+    // Whether the last pop was from the back, and the blocks before _firstResident are not in memory when it was.
+    bool _popsBack = false;
+    std::size_t _firstResident = 0;
+#ifdef __linux__
+    // Elements of a deque stay in place while others are pushed and popped at the ends.
+    std::deque<block_t *> _writes;
+    // Declared last, so pending requests complete before the blocks holding their buffers are destroyed.
+    std::unique_ptr<reachability_detail::spill_file_t> _file;
+
+    void spill(block_t &block) {
+        if (!_file)
+            _file = std::make_unique<reachability_detail::spill_file_t>();
+        block.bytes = static_cast<std::uint32_t>(block.deltas.size());
+        block.offset = _file->allocate(block.bytes);
+        block.ticket = _file->write(block.deltas.data(), block.bytes, block.offset);
+        block.where = residence::writing;
+        --_resident;
+        ++_onDisk;
+        _spilled += block.bytes;
+        _writes.push_back(&block);
+        if (_writes.size() > write_behind) {
+            auto &written = *_writes.front();
+            _writes.pop_front();
+            _file->wait(written.ticket);
+            recycle(written.deltas);
+            written.where = residence::disk;
+        }
+    }
+
+    void load(block_t &block) {
+        block.deltas.resize(block.bytes);
+        block.ticket = _file->read(block.deltas.data(), block.bytes, block.offset);
+        block.where = residence::reading;
+    }
+
+    // Starts reading the spilled blocks next to be popped, from the end the last pop was from.
+    void readAhead() {
+        for (std::size_t i = 0; i < spill_policy::readAhead && i < _blocks.size() && _onDisk; ++i) {
+            auto &block = _popsBack ? _blocks[_blocks.size() - 1 - i] : _blocks[i];
+            if (block.where == residence::disk)
+                load(block);
+        }
+    }
+#endif
+
+    // The oldest block in memory, popped last from the back. A spilled block stays out of memory until it is popped.
+    block_t &oldestResident() {
+        while (_blocks[_firstResident].where != residence::memory) {
+            ++_firstResident;
+        }
+        return _blocks[_firstResident];
+    }
+
+    // Decodes a block about to be popped, waiting for its pending write or read.
+    void take(block_t &block, std::vector<node_t> &nodes) {
+        if (block.where == residence::memory) {
+            --_resident;
+        }
+#ifdef __linux__
+        else {
+            if (block.where == residence::writing) {
+                _writes.erase(std::find(_writes.begin(), _writes.end(), &block));
+            } else if (block.where == residence::disk) {
+                load(block);
+            }
+            _file->wait(block.ticket);
+            _file->release(block.offset, block.bytes);
+            --_onDisk;
+        }
+#endif
+        decode(block, nodes);
+        recycle(block.deltas);
+    }
+
+    // Keeps the buffer of a block which is no longer needed, or releases it.
+    void recycle(std::vector<std::uint8_t> &deltas) {
+        if (_spare.size() < spare_buffers) {
+            _spare.push_back(std::move(deltas));
+        }
+        std::vector<std::uint8_t>().swap(deltas);
+    }
+
+    block_t encode(const std::vector<node_t> &nodes) {
+        block_t block{nodes.front(), {}};
+        if (_spare.empty()) {
+            block.deltas.reserve(nodes.size());
+        } else {
+            block.deltas.swap(_spare.back());
+            _spare.pop_back();
+            block.deltas.clear();
+        }
+        for (std::size_t i = 1; i < nodes.size(); ++i) {
+            auto delta = static_cast<std::int64_t>(nodes[i]) - static_cast<std::int64_t>(nodes[i - 1]);
+            auto zigzag = (static_cast<std::uint64_t>(delta) << 1) ^ static_cast<std::uint64_t>(delta >> 63);
+            for (; zigzag >= 0x80; zigzag >>= 7) {
+                block.deltas.push_back(static_cast<std::uint8_t>(zigzag | 0x80));
+            }
+            block.deltas.push_back(static_cast<std::uint8_t>(zigzag));
+        }
+        // Deltas mostly take a byte per node, so only a buffer far larger than its block is trimmed.
+        if (block.deltas.capacity() > 2 * block.deltas.size()) {
+            block.deltas.shrink_to_fit();
+        }
+        return block;
+    }
+
+    static void decode(const block_t &block, std::vector<node_t> &nodes) {
+        nodes.reserve(block_nodes);
+        auto node = static_cast<std::int64_t>(block.first);
+        nodes.push_back(block.first);
+        for (auto it = block.deltas.begin(); it != block.deltas.end();) {
+            std::uint64_t zigzag = 0;
+            for (unsigned shift = 0;; shift += 7) {
+                auto byte = *it++;
+                zigzag |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                    break;
+            }
+            node += static_cast<std::int64_t>(zigzag >> 1) ^ -static_cast<std::int64_t>(zigzag & 1);
+            nodes.push_back(static_cast<node_t>(node));
+        }
+    }
+};
+
+// Tuning of the sort-based breadth-first search, see search_order::sorted_breadth_first.
+struct sorted_search_policy {
+    // Number of previous layers a new layer is checked against, 0 checks all of them. Two layers suffice when every
+    // transition can be undone, with fewer layers states reached again later are expanded again, and a search over
+    // cycles longer than the window does not terminate.
+    static inline std::size_t duplicateLayers = 0;
+    // Threads sorting the layers, 0 uses all hardware threads.
+    static inline std::size_t threads = 0;
+};
+
+namespace reachability_detail {
+    // Runs f(thread, begin, end) over slices of [0, size) on the given number of threads.
+    template<class F>
+    void parallel_for(std::size_t threads, std::size_t size, F &&f) {
+        if (threads <= 1 || size < threads) {
+            f(std::size_t{0}, std::size_t{0}, size);
+            return;
+        }
+        std::vector<std::thread> workers;
+        for (std::size_t thread = 1; thread < threads; ++thread) {
+            workers.emplace_back([&f, thread, threads, size] {
+                f(thread, size * thread / threads, size * (thread + 1) / threads);
+            });
+        }
+        f(std::size_t{0}, std::size_t{0}, size / threads);
+        for (auto &worker: workers) {
+            worker.join();
+        }
+    }
+}
+
+// Tuning of the parallel breadth-first and cost searches. The states a round expands are taken in the order of the
+// sequential search, expanded on the threads at once and their successors committed in that same order, so every
+// state gets the same parent and the traces are reported in the same order for any number of threads. The threads also
+// hash their successors and look them up in their filters and the pool, so the commit only interns the new states, see
+// state_space_t::filterStatistics. The transition,
+// invariant and cost functions are then called concurrently and must not modify shared data. Depth-first search
+// expands one state at a time and stays sequential.
+struct parallel_search_policy {
+    // Threads expanding states, 1 expands on the calling thread and 0 uses all hardware threads.
+    static inline std::size_t threads = 1;
+};
+
+// Tuning of the pipelined breadth-first search, which runs successor generation, invariant filtering and hashing as
+// stages on their own threads, connected by bounded queues of batches. The calling thread pops the waiting states,
+// checks goals and passed states, and interns and records the hashed successors of the batches in the order it
+// dispatched them, so the search reports the same traces as the default solver. A stage without threads is done by
+// the stage before it. The search is pipelined when generators is above 0, which takes precedence over
+// parallel_search_policy for breadth-first search, and the functions called by the stages must not modify shared data.
+struct pipeline_search_policy {
+    static inline std::size_t generators = 0;
+    static inline std::size_t filters = 0;
+    static inline std::size_t hashers = 0;
+    // States expanded by a batch, and batches in flight through the pipeline at once.
+    static inline std::size_t batchStates = 256;
+    static inline std::size_t batches = 16;
+};
+
+namespace reachability_detail {
+    // Orders the waiting (cost, trace node) entries of the cost searches in a std::priority_queue. Ties in cost are
+    // broken in favour of the earliest generated trace node, so equally cheap states are explored in breadth-first
+    // order. The sequential, parallel, shared and distributed cost searches all use it, which keeps their traces the
+    // same.
+    template<class EntryT>
+    struct cost_order_t {
+        bool operator()(const EntryT &a, const EntryT &b) const {
+            if (a.first < b.first)
+                return true;
+            if (b.first < a.first)
+                return false;
+            return a.second > b.second;
+        }
+    };
+
+    inline std::size_t search_threads() {
+        return parallel_search_policy::threads ? parallel_search_policy::threads
+                                               : std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Bounded lock-free queue of several producers and consumers. Every cell carries a sequence number telling whether
+    // it is free for the push or holds the item for the pop of the current lap, so a push and a pop only contend on
+    // their own position and never on each other.
+    template<class T>
+    class mpmc_ring_t {
+    public:
+        // The capacity is rounded up to a power of two.
+        explicit mpmc_ring_t(std::size_t capacity) {
+            std::size_t size = 2;
+            while (size < capacity) {
+                size <<= 1;
+            }
+            _mask = size - 1;
+            _cells = std::make_unique<cell_t[]>(size);
+            for (std::size_t i = 0; i < size; ++i) {
+                _cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        // Moves the item into the queue unless it is full.
+        bool tryPush(T &item) {
+            auto position = _pushed.load(std::memory_order_relaxed);
+            while (true) {
+                auto &cell = _cells[position & _mask];
+                auto sequence = cell.sequence.load(std::memory_order_acquire);
+                auto lap = static_cast<std::ptrdiff_t>(sequence - position);
+                if (lap == 0) {
+                    if (_pushed.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        cell.item = std::move(item);
+                        cell.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (lap < 0) {
+                    return false;
+                } else {
+                    position = _pushed.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Takes the oldest item unless the queue is empty.
+        bool tryPop(T &item) {
+            auto position = _popped.load(std::memory_order_relaxed);
+            while (true) {
+                auto &cell = _cells[position & _mask];
+                auto sequence = cell.sequence.load(std::memory_order_acquire);
+                auto lap = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+                if (lap == 0) {
+                    if (_popped.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        item = std::move(cell.item);
+                        cell.sequence.store(position + _mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (lap < 0) {
+                    return false;
+                } else {
+                    position = _popped.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+    private:
+        struct cell_t {
+            std::atomic<std::size_t> sequence{0};
+            T item{};
+        };
+        std::unique_ptr<cell_t[]> _cells;
+        std::size_t _mask = 0;
+        // The positions are on their own cache lines, as producers and consumers run on different threads.
+        alignas(64) std::atomic<std::size_t> _pushed{0};
+        alignas(64) std::atomic<std::size_t> _popped{0};
+    };
+
+    // Bounded queue of batches between two stages of a pipeline. Producers wait while it is full and consumers while it
+    // is empty, and once closed by the last producer the consumers drain it and stop. Items pass through a lock-free
+    // ring and only a thread which has to wait takes the lock, a push or pop notifies only when a thread sleeps.
+    template<class T>
+    class batch_queue_t {
+    public:
+        explicit batch_queue_t(std::size_t capacity, std::size_t producers = 1)
+                : _ring(capacity), _producers(producers) {}
+
+        void push(T item) {
+            if (!_ring.tryPush(item)) {
+                sleep([&] { return _ring.tryPush(item); });
+            }
+            wake();
+        }
+
+        // Takes the next item, returns false when the queue is closed and drained.
+        bool pop(T &item) {
+            auto popped = _ring.tryPop(item);
+            if (!popped) {
+                // Every push of a producer comes before its close, so an empty ring after the last close is drained.
+                sleep([&] {
+                    auto closed = _producers.load() == 0;
+                    popped = _ring.tryPop(item);
+                    return popped || closed;
+                });
+                if (!popped)
+                    return false;
+            }
+            wake();
+            return true;
+        }
+
+        // Called by every producer when done.
+        void close() {
+            auto producers = _producers.load();
+            while (producers > 0 && !_producers.compare_exchange_weak(producers, producers - 1)) {
+            }
+            if (producers == 1)
+                wake();
+        }
+
+    private:
+        template<class ReadyF>
+        void sleep(ReadyF ready) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _sleepers.fetch_add(1);
+            _changed.wait(lock, ready);
+            _sleepers.fetch_sub(1);
+        }
+
+        // The sleepers are read with a read-modify-write, which either comes after the announcement of a sleeper or
+        // publishes the ring to the sleeper before it looks at the ring.
+        void wake() {
+            if (_sleepers.fetch_add(0) > 0) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _changed.notify_all();
+            }
+        }
+
+        mpmc_ring_t<T> _ring;
+        std::atomic<std::size_t> _producers;
+        std::atomic<std::size_t> _sleepers{0};
+        std::mutex _mutex;
+        // Producers and consumers share the condition, they rarely both sleep on one queue.
+        std::condition_variable _changed;
+    };
+
+    // Threads kept for the rounds of a parallel search, which are too short to start threads for each. The calling
+    // thread takes part in every round as worker 0. On a machine of several NUMA nodes it is pinned to the node it
+    // runs on while the pool lives, the home node where the search binds the tables it interns into, and the other
+    // workers are pinned round-robin to the nodes after it. A search gives every worker its own scratch buffers bound
+    // to the node of the worker, see node. A machine of a single node pins nothing and leaves all placement to first
+    // touch.
+    class worker_pool_t {
+    public:
+        explicit worker_pool_t(std::size_t threads) {
+            auto &topology = numa_topology::system();
+            auto home = topology.currentNode();
+#ifdef __linux__
+            if (home >= 0) {
+                _restore = pthread_getaffinity_np(pthread_self(), sizeof(_affinity), &_affinity) == 0;
+                topology.pinToNode(static_cast<std::size_t>(home));
+            }
+#endif
+            _nodes.push_back(home);
+            for (std::size_t thread = 1; thread < threads; ++thread) {
+                auto node = home < 0 ? -1 : static_cast<int>((home + thread) % topology.nodes());
+                _nodes.push_back(node);
+                _workers.emplace_back([this, thread, node, &topology] {
+                    if (node >= 0)
+                        topology.pinToNode(static_cast<std::size_t>(node));
+                    work(thread);
+                });
+            }
+        }
+
+        worker_pool_t(const worker_pool_t &) = delete;
+        worker_pool_t &operator=(const worker_pool_t &) = delete;
+
+        ~worker_pool_t() {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            _wake.notify_all();
+            for (auto &worker: _workers) {
+                worker.join();
+            }
+#ifdef __linux__
+            if (_restore)
+                pthread_setaffinity_np(pthread_self(), sizeof(_affinity), &_affinity);
+#endif
+        }
+
+        // The number of workers, including the calling thread.
+        std::size_t size() const {
+            return _nodes.size();
+        }
+
+        // The NUMA node a worker is pinned to, the home node for worker 0, or -1 when the pool pins nothing.
+        int node(std::size_t worker) const {
+            return _nodes[worker];
+        }
+
+        // Calls f(i, worker) for every i of [0, count) on all threads, the worker being the index of the calling one,
+        // and returns when all calls have returned. The first exception thrown by a call is rethrown.
+        template<class F>
+        void run(std::size_t count, F &&f) {
+            if (_workers.empty() || count <= 1) {
+                for (std::size_t i = 0; i < count; ++i) {
+                    f(i, std::size_t{0});
+                }
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _task = [](void *context, std::size_t i, std::size_t worker) {
+                    (*static_cast<std::remove_reference_t<F> *>(context))(i, worker);
+                };
+                _context = &f;
+                _count = count;
+                _next = 0;
+                _busy = _workers.size();
+                ++_round;
+            }
+            _wake.notify_all();
+            take(0);
+            std::unique_lock<std::mutex> lock(_mutex);
+            _done.wait(lock, [this] { return _busy == 0; });
+            if (_error) {
+                std::exception_ptr error;
+                std::swap(error, _error);
+                std::rethrow_exception(error);
+            }
+        }
+
+    private:
+        std::vector<std::thread> _workers;
+        std::vector<int> _nodes;
+#ifdef __linux__
+        // The affinity of the calling thread before it was pinned to the home node.
+        cpu_set_t _affinity;
+        bool _restore = false;
+#endif
+        std::mutex _mutex;
+        std::condition_variable _wake, _done;
+        void (*_task)(void *, std::size_t, std::size_t) = nullptr;
+        void *_context = nullptr;
+        std::size_t _count = 0;
+        std::atomic<std::size_t> _next{0};
+        std::size_t _busy = 0;
+        std::size_t _round = 0;
+        bool _stop = false;
+        std::exception_ptr _error;
+
+        // Takes indices of the round until none are left.
+        void take(std::size_t worker) {
+            for (auto i = _next++; i < _count; i = _next++) {
+                try {
+                    _task(_context, i, worker);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    if (!_error)
+                        _error = std::current_exception();
+                }
+            }
+        }
+
+        void work(std::size_t worker) {
+            std::size_t round = 0;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _wake.wait(lock, [this, round] { return _stop || _round != round; });
+                    if (_stop)
+                        return;
+                    round = _round;
+                }
+                take(worker);
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (--_busy == 0)
+                    _done.notify_one();
+            }
+        }
+    };
+}
+
+// Breadth-first layers of packed states for the sort-based search. A layer holds distinct states of equal width in
+// the order of their hashes, each with the index of its parent in the previous layer. The next layer is collected
+// unsorted, then radix sorted in parallel, stripped of duplicates and of the states of earlier layers by merging with
+// them, so all accesses stream through flat arrays instead of probing a hash table.
+// Closed layers are kept compressed in blocks of block_states states, each byte column bit-packed in as many bits as
+// it varies in throughout the block. The bytes of small enumerations take a few bits and those of sizes none, and a
+// single state is unpacked from its offset without decoding the rest of its block.
+class packed_layers_t {
+public:
+    static constexpr std::uint32_t no_parent = static_cast<std::uint32_t>(-1);
+    static constexpr std::size_t block_states = 256;
+
+    explicit packed_layers_t(std::size_t width) : _width(width) {}
+
+    std::size_t width() const {
+        return _width;
+    }
+
+    // The number of closed layers.
+    std::size_t layers() const {
+        return _closed;
+    }
+
+    std::size_t size(std::size_t layer) const {
+        return _layers[layer].parents.size();
+    }
+
+    // Unpacks a state of a closed layer into width() bytes.
+    void state(std::size_t layer, std::size_t index, char *bytes) const {
+        auto &closed = _layers[layer];
+        unpack(closed.packed.data() + closed.blockStarts[index / block_states], index % block_states, bytes);
+    }
+
+    // Unpacks a block of a closed layer and returns the number of states in it.
+    std::size_t unpackBlock(std::size_t layer, std::size_t block, std::vector<char> &bytes) const {
+        auto &closed = _layers[layer];
+        auto first = block * block_states;
+        auto count = std::min(block_states, closed.parents.size() - first);
+        bytes.resize(count * _width);
+        for (std::size_t i = 0; i < count; ++i) {
+            unpack(closed.packed.data() + closed.blockStarts[block], i, bytes.data() + i * _width);
+        }
+        return count;
+    }
+
+    std::uint32_t parent(std::size_t layer, std::size_t index) const {
+        return _layers[layer].parents[index];
+    }
+
+    // Adds a state to the next layer.
+    void add(const char *bytes, std::uint32_t parent) {
+        if (_layers.size() == _closed) {
+            _layers.emplace_back();
+        }
+        auto &open = _layers.back();
+        if (open.parents.size() == no_parent) {
+            throw std::length_error("layer exceeds 32-bit state indices");
+        }
+        open.bytes.insert(open.bytes.end(), bytes, bytes + _width);
+        open.parents.push_back(parent);
+    }
+
+    // Closes the next layer and returns the number of new states in it.
+    std::size_t close() {
+        if (_layers.size() == _closed) {
+            _layers.emplace_back();
+        }
+        auto layer = static_cast<std::uint32_t>(_closed++);
+        auto &open = _layers.back();
+        auto count = open.parents.size();
+        auto threads = sorted_search_policy::threads ? sorted_search_policy::threads
+                                                     : std::max(1u, std::thread::hardware_concurrency());
+        if (count < parallel_threshold)
+            threads = 1;
+
+        _radixBits = 1;
+        while (_radixBits < max_radix_bits && (count >> _radixBits) > bucket_size)
+            ++_radixBits;
+        _buckets = std::size_t{1} << _radixBits;
+        _entries.resize(count);
+        reachability_detail::parallel_for(threads, count, [&](std::size_t, std::size_t begin, std::size_t end) {
+            for (auto i = begin; i < end; ++i) {
+                auto hash = reachability_detail::hash_wyhash(open.bytes.data() + i * _width, _width);
+                _entries[i] = entry_t{reachability_detail::mix(hash), static_cast<std::uint32_t>(i), layer};
+            }
+        });
+        partition(threads);
+
+        // Sort every bucket and mark the first of equal states which is not in an earlier layer, _buckets hold
+        // disjoint hash ranges so the threads work on them independently.
+        _kept.assign(count, 0);
+        reachability_detail::parallel_for(threads, _buckets, [&](std::size_t, std::size_t begin, std::size_t end) {
+            for (auto bucket = begin; bucket < end; ++bucket) {
+                auto first = _sorted.begin() + static_cast<std::ptrdiff_t>(_bucketStarts[bucket]);
+                auto last = _sorted.begin() + static_cast<std::ptrdiff_t>(_bucketStarts[bucket + 1]);
+                std::sort(first, last, [this](const entry_t &a, const entry_t &b) {
+                    auto order = compare(a, b);
+                    return order < 0 || (order == 0 && a.index < b.index);
+                });
+                for (auto it = first; it != last; ++it) {
+                    if (it == first || compare(*(it - 1), *it) != 0)
+                        _kept[static_cast<std::size_t>(it - _sorted.begin())] = 1;
+                }
+                for (auto &run: _runs) {
+                    subtract(bucket, run);
+                }
+            }
+        });
+
+        // Compact the kept states in sorted order, which becomes their order in the layer, and pack them in blocks.
+        layer_t closed;
+        run_t run;
+        std::vector<std::uint32_t> order;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (!_kept[i])
+                continue;
+            auto &entry = _sorted[i];
+            order.push_back(entry.index);
+            closed.parents.push_back(open.parents[entry.index]);
+            run.push_back(entry_t{entry.hash, static_cast<std::uint32_t>(run.size()), layer});
+        }
+        std::vector<std::vector<std::uint8_t>> blocks((order.size() + block_states - 1) / block_states);
+        reachability_detail::parallel_for(
+                order.size() < parallel_threshold ? 1 : threads, blocks.size(),
+                [&](std::size_t, std::size_t begin, std::size_t end) {
+                    std::vector<char> states;
+                    for (auto block = begin; block < end; ++block) {
+                        auto first = block * block_states;
+                        auto last = std::min(first + block_states, order.size());
+                        states.clear();
+                        for (auto i = first; i < last; ++i) {
+                            auto bytes = open.bytes.data() + std::size_t{order[i]} * _width;
+                            states.insert(states.end(), bytes, bytes + _width);
+                        }
+                        pack(states.data(), last - first, blocks[block]);
+                    }
+                });
+        for (auto &block: blocks) {
+            closed.blockStarts.push_back(closed.packed.size());
+            closed.packed.insert(closed.packed.end(), block.begin(), block.end());
+        }
+        closed.packed.shrink_to_fit();
+        open = std::move(closed);
+        remember(std::move(run));
+        return open.parents.size();
+    }
+
+private:
+    // The next layer holds its states as they are added, a closed layer only packed blocks.
+    struct layer_t {
+        std::vector<char> bytes;
+        std::vector<std::uint8_t> packed;
+        std::vector<std::size_t> blockStarts;
+        std::vector<std::uint32_t> parents;
+    };
+
+    // A state of a layer by its hash, which gives the sort order, ties are ordered by the bytes.
+    struct entry_t {
+        std::uint64_t hash;
+        std::uint32_t index;
+        std::uint32_t layer;
+    };
+    using run_t = std::vector<entry_t>;
+
+    // The partition uses up to 2^max_radix_bits buckets of about bucket_size states.
+    static constexpr std::size_t max_radix_bits = 11;
+    static constexpr std::size_t bucket_size = 256;
+    static constexpr std::size_t parallel_threshold = 1 << 14;
+
+    std::size_t _width;
+    std::size_t _closed = 0;
+    std::vector<layer_t> _layers;
+    // Sorted runs of the earlier layers. Checking all layers merges the runs into runs of geometrically growing
+    // size, so a layer is checked against few runs, otherwise the runs are the last layers.
+    std::vector<run_t> _runs;
+    std::vector<entry_t> _entries;
+    std::vector<entry_t> _sorted;
+    std::size_t _radixBits = 1;
+    std::size_t _buckets = 2;
+    std::vector<std::size_t> _bucketStarts;
+    std::vector<unsigned char> _kept;
+
+    // A block starts with its first state, the bits of a state and the columns varying in the block with their bit
+    // widths, then the bit-packed differences of the states to the first follow with a byte of padding, so every
+    // value is read as two bytes. The differences are exclusive ors, which takes a single pass to size the columns.
+    void pack(const char *states, std::size_t count, std::vector<std::uint8_t> &block) const {
+        std::vector<std::uint8_t> differences(_width, 0);
+        auto any = differences.data();
+        for (std::size_t i = 1; i < count; ++i) {
+            auto state = states + i * _width;
+            for (std::size_t column = 0; column < _width; ++column) {
+                any[column] |= static_cast<std::uint8_t>(state[column] ^ states[column]);
+            }
+        }
+        std::vector<std::uint32_t> columns;
+        std::vector<std::uint8_t> widths;
+        std::uint32_t bits = 0;
+        for (std::size_t column = 0; column < _width; ++column) {
+            std::uint8_t width = 0;
+            for (auto range = differences[column]; range; range >>= 1)
+                ++width;
+            if (width) {
+                columns.push_back(static_cast<std::uint32_t>(column));
+                widths.push_back(width);
+                bits += width;
+            }
+        }
+        auto varying = static_cast<std::uint32_t>(columns.size());
+        auto header = _width + sizeof(bits) + sizeof(varying) + varying * (sizeof(std::uint32_t) + 1);
+        block.assign(header + (count * bits + 7) / 8 + 1, 0);
+        std::memcpy(block.data(), states, _width);
+        std::memcpy(block.data() + _width, &bits, sizeof(bits));
+        std::memcpy(block.data() + _width + sizeof(bits), &varying, sizeof(varying));
+        std::copy(widths.begin(), widths.end(), block.begin() + static_cast<std::ptrdiff_t>(header - varying));
+        for (std::size_t k = 0; k < varying; ++k) {
+            std::memcpy(block.data() + _width + sizeof(bits) + sizeof(varying) + k * sizeof(std::uint32_t),
+                        &columns[k], sizeof(std::uint32_t));
+        }
+        std::size_t position = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            for (std::size_t k = 0; k < varying; ++k) {
+                auto value = static_cast<unsigned>(static_cast<std::uint8_t>(states[i * _width + columns[k]] ^
+                                                                             states[columns[k]])) << (position & 7);
+                block[header + position / 8] |= static_cast<std::uint8_t>(value);
+                block[header + position / 8 + 1] |= static_cast<std::uint8_t>(value >> 8);
+                position += widths[k];
+            }
+        }
+    }
+
+    void unpack(const std::uint8_t *block, std::size_t index, char *bytes) const {
+        std::memcpy(bytes, block, _width);
+        std::uint32_t bits, varying;
+        std::memcpy(&bits, block + _width, sizeof(bits));
+        std::memcpy(&varying, block + _width + sizeof(bits), sizeof(varying));
+        auto columns = block + _width + sizeof(bits) + sizeof(varying);
+        auto widths = columns + varying * sizeof(std::uint32_t);
+        auto stream = widths + varying;
+        auto position = index * bits;
+        for (std::size_t k = 0; k < varying; ++k) {
+            std::uint32_t column;
+            std::memcpy(&column, columns + k * sizeof(column), sizeof(column));
+            auto window = (stream[position / 8] | unsigned{stream[position / 8 + 1]} << 8) >> (position & 7);
+            auto value = window & ((1u << widths[k]) - 1);
+            bytes[column] = static_cast<char>(block[column] ^ value);
+            position += widths[k];
+        }
+    }
+
+    // The bytes of a state of the next layer in place, those of a closed layer unpacked into the buffer.
+    const char *bytes(const entry_t &entry, std::vector<char> &buffer) const {
+        auto &layer = _layers[entry.layer];
+        if (!layer.bytes.empty())
+            return layer.bytes.data() + std::size_t{entry.index} * _width;
+        buffer.resize(_width);
+        state(entry.layer, entry.index, buffer.data());
+        return buffer.data();
+    }
+
+    int compare(const entry_t &a, const entry_t &b) const {
+        if (a.hash != b.hash)
+            return a.hash < b.hash ? -1 : 1;
+        static thread_local std::vector<char> first, second;
+        return std::memcmp(bytes(a, first), bytes(b, second), _width);
+    }
+
+    bool less(const entry_t &a, const entry_t &b) const {
+        return compare(a, b) < 0;
+    }
+
+    // Drops the kept states of a bucket found in a run of earlier layers by merging the bucket with the same hash
+    // range of the run. The run is searched forward from the previous match, so a run much larger than the layer is
+    // skipped over instead of scanned.
+    void subtract(std::size_t bucket, const run_t &run) {
+        auto hashOrder = [](const entry_t &entry, std::uint64_t hash) { return entry.hash < hash; };
+        auto lowest = static_cast<std::uint64_t>(bucket) << (64 - _radixBits);
+        auto cursor = std::lower_bound(run.begin(), run.end(), lowest, hashOrder);
+        auto last = bucket + 1 == _buckets ? run.end() : std::lower_bound(
+                cursor, run.end(), static_cast<std::uint64_t>(bucket + 1) << (64 - _radixBits), hashOrder);
+        for (auto i = _bucketStarts[bucket]; i < _bucketStarts[bucket + 1] && cursor != last; ++i) {
+            if (!_kept[i])
+                continue;
+            cursor = std::lower_bound(cursor, last, _sorted[i],
+                                      [this](const entry_t &a, const entry_t &b) { return less(a, b); });
+            if (cursor != last && compare(*cursor, _sorted[i]) == 0)
+                _kept[i] = 0;
+        }
+    }
+
+    // Radix partition by the top bits of the hash: every thread counts its slice, then scatters it to the offsets of
+    // its own share of every bucket.
+    void partition(std::size_t threads) {
+        auto count = _entries.size();
+        std::vector<std::size_t> counts(threads * _buckets, 0);
+        auto slice = [threads, count](std::size_t thread) {
+            return std::make_pair(count * thread / threads, count * (thread + 1) / threads);
+        };
+        auto digit = [this](const entry_t &entry) {
+            return static_cast<std::size_t>(entry.hash >> (64 - _radixBits));
+        };
+        reachability_detail::parallel_for(threads, threads, [&](std::size_t, std::size_t begin, std::size_t end) {
+            for (auto thread = begin; thread < end; ++thread) {
+                auto range = slice(thread);
+                for (auto i = range.first; i < range.second; ++i)
+                    ++counts[thread * _buckets + digit(_entries[i])];
+            }
+        });
+        _bucketStarts.assign(_buckets + 1, 0);
+        std::size_t offset = 0;
+        for (std::size_t bucket = 0; bucket < _buckets; ++bucket) {
+            _bucketStarts[bucket] = offset;
+            for (std::size_t thread = 0; thread < threads; ++thread) {
+                auto share = counts[thread * _buckets + bucket];
+                counts[thread * _buckets + bucket] = offset;
+                offset += share;
+            }
+        }
+        _bucketStarts[_buckets] = offset;
+        _sorted.resize(count);
+        reachability_detail::parallel_for(threads, threads, [&](std::size_t, std::size_t begin, std::size_t end) {
+            for (auto thread = begin; thread < end; ++thread) {
+                auto range = slice(thread);
+                for (auto i = range.first; i < range.second; ++i)
+                    _sorted[counts[thread * _buckets + digit(_entries[i])]++] = _entries[i];
+            }
+        });
+    }
+
+    void remember(run_t run) {
+        _runs.push_back(std::move(run));
+        if (sorted_search_policy::duplicateLayers) {
+            if (_runs.size() > sorted_search_policy::duplicateLayers)
+                _runs.erase(_runs.begin());
+            return;
+        }
+        while (_runs.size() > 1 && _runs[_runs.size() - 2].size() <= 2 * _runs.back().size()) {
+            auto &previous = _runs[_runs.size() - 2];
+            run_t merged(previous.size() + _runs.back().size());
+            std::merge(previous.begin(), previous.end(), _runs.back().begin(), _runs.back().end(), merged.begin(),
+                       [this](const entry_t &a, const entry_t &b) { return less(a, b); });
+            _runs.pop_back();
+            _runs.back() = std::move(merged);
+        }
+    }
+};
+
+// Store of the trace nodes of a distributed search. The parent of a node may live on another process of the cluster,
+// so it is referred to by the rank of that process and the node there.
+class distributed_trace_store_t {
+public:
+    using node_t = trace_store_t::node_t;
+    static constexpr std::uint32_t no_rank = static_cast<std::uint32_t>(-1);
+
+    struct parent_t {
+        std::uint32_t rank;
+        node_t node;
+    };
+
+    node_t add(parent_t parent, state_id_t state) {
+        if (_nodes.size() == trace_store_t::no_parent) {
+            throw std::length_error("trace store exceeds 32-bit node ids");
+        }
+        _nodes.push_back(node_state{parent, state});
+        return static_cast<node_t>(_nodes.size() - 1);
+    }
+
+    state_id_t state(node_t node) const {
+        return _nodes[node].state;
+    }
+
+    parent_t parent(node_t node) const {
+        return _nodes[node].parent;
+    }
+
+private:
+    struct node_state {
+        parent_t parent;
+        state_id_t state;
+    };
+
+    std::vector<node_state, large_table_allocator<node_state>> _nodes;
+};
+
+#ifdef __linux__
+// The processes of a distributed search, connected pairwise over TCP. Every process builds the same state space and
+// calls check with its cluster: each process owns the states hashing to its rank and the successors owned by others
+// are sent to them in batches. The search proceeds in rounds, a round ends once every process has received the round
+// marker of all others, and the markers tell whether any process has work left, which detects termination.
+class cluster_t {
+public:
+    enum class frame : std::uint8_t {
+        round_end, states, trace_goals, trace_walks, trace_states
+    };
+
+    struct endpoint_t {
+        std::string host;
+        std::uint16_t port;
+    };
+
+    // Records of one kind are collected up to this size before they are sent to a peer.
+    static constexpr std::size_t batch_bytes = 1 << 16;
+
+    // Joins the cluster of the given endpoints as the process of the given rank. The processes may start in any
+    // order, connecting to a peer is retried until it listens.
+    cluster_t(std::size_t rank, const std::vector<endpoint_t> &endpoints) : _rank(rank) {
+        join(listen(endpoints[rank].port, false), endpoints);
+    }
+
+    // Forks a cluster of processes on this machine connected over the loopback interface. The calling process
+    // becomes rank 0 and waits for the others when its cluster is destroyed. The forked processes continue from here
+    // with their own rank, so they run the same searches, and should return from main afterwards.
+    static cluster_t loopback(std::size_t processes) {
+        std::vector<int> listeners;
+        std::vector<endpoint_t> endpoints;
+        for (std::size_t rank = 0; rank < processes; ++rank) {
+            listeners.push_back(listen(0, true));
+            sockaddr_in address{};
+            socklen_t length = sizeof(address);
+            ::getsockname(listeners.back(), reinterpret_cast<sockaddr *>(&address), &length);
+            endpoints.push_back(endpoint_t{"127.0.0.1", ntohs(address.sin_port)});
+        }
+        // Output buffered so far would otherwise be written by every process.
+        std::cout.flush();
+        std::size_t rank = 0;
+        std::vector<pid_t> children;
+        for (std::size_t child = 1; child < processes; ++child) {
+            auto pid = ::fork();
+            if (pid < 0) {
+                throw std::system_error(errno, std::generic_category(), "fork");
+            }
+            if (pid == 0) {
+                rank = child;
+                children.clear();
+                break;
+            }
+            children.push_back(pid);
+        }
+        for (std::size_t other = 0; other < processes; ++other) {
+            if (other != rank) {
+                ::close(listeners[other]);
+            }
+        }
+        auto result = cluster_t(rank);
+        result._children = std::move(children);
+        result.join(listeners[rank], endpoints);
+        return result;
+    }
+
+    cluster_t(cluster_t &&) = default;
+
+    cluster_t(const cluster_t &) = delete;
+
+    cluster_t &operator=(const cluster_t &) = delete;
+
+    ~cluster_t() {
+        for (auto socket: _sockets) {
+            if (socket >= 0) {
+                ::close(socket);
+            }
+        }
+        for (auto child: _children) {
+            ::waitpid(child, nullptr, 0);
+        }
+    }
+
+    std::size_t rank() const {
+        return _rank;
+    }
+
+    std::size_t size() const {
+        return _sockets.size();
+    }
+
+    // The process owning an encoded state. The hash is seeded apart from the state pool hash, which would otherwise
+    // see the same low bits for all states of a partition and use only a fraction of its slots.
+    std::size_t owner(const std::vector<char> &encoded) const {
+        auto hash = reachability_detail::hash_wyhash(encoded.data(), encoded.size());
+        return reachability_detail::mix(hash ^ partition_seed) % _sockets.size();
+    }
+
+    // Queues a frame for a peer. While too much is queued for the peer, incoming frames are handled and passed to
+    // handle(peer, kind, data, size), which must not post itself.
+    template<class HandlerF>
+    void post(std::size_t peer, frame kind, const std::vector<char> &payload, HandlerF &&handle) {
+        auto &out = _outgoing[peer];
+        reachability_detail::put(out, static_cast<std::uint32_t>(payload.size()));
+        reachability_detail::put(out, kind);
+        out.insert(out.end(), payload.begin(), payload.end());
+        while (out.size() - _sent[peer] > max_pending) {
+            step(handle, true);
+        }
+    }
+
+    // Sends and receives whatever is possible without blocking.
+    template<class HandlerF>
+    void pump(HandlerF &&handle) {
+        step(handle, false);
+    }
+
+    // Ends the round of this process with a marker and handles the incoming frames until all processes have ended
+    // theirs. Returns the markers by rank.
+    template<class HandlerF>
+    std::vector<std::vector<char>> endRound(const std::vector<char> &marker, HandlerF &&handle) {
+        for (std::size_t peer = 0; peer < size(); ++peer) {
+            if (peer != _rank) {
+                post(peer, frame::round_end, marker, handle);
+            }
+        }
+        _markers[_rank] = marker;
+        _ended[_rank] = true;
+        while (!roundComplete()) {
+            step(handle, true);
+        }
+        // Frames of the next round stay buffered until then.
+        std::fill(_ended.begin(), _ended.end(), false);
+        return _markers;
+    }
+
+private:
+    static constexpr std::uint64_t partition_seed = 0x2545f4914f6cdd1dULL;
+    static constexpr std::size_t max_pending = 1 << 24;
+    static constexpr std::size_t read_size = 1 << 18;
+    static constexpr std::size_t header_size = sizeof(std::uint32_t) + sizeof(frame);
+
+    std::size_t _rank;
+    std::vector<int> _sockets;
+    std::vector<pid_t> _children;
+    std::vector<std::vector<char>> _outgoing;
+    std::vector<std::size_t> _sent;
+    std::vector<std::vector<char>> _incoming;
+    std::vector<std::size_t> _received;
+    std::vector<bool> _ended;
+    std::vector<std::vector<char>> _markers;
+    std::vector<bool> _closed;
+    std::vector<pollfd> _polled;
+    std::vector<std::size_t> _polledPeers;
+
+    explicit cluster_t(std::size_t rank) : _rank(rank) {}
+
+    static void check(bool success, const char *what) {
+        if (!success) {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+    }
+
+    static int listen(std::uint16_t port, bool loopback) {
+        auto listener = ::socket(AF_INET, SOCK_STREAM, 0);
+        check(listener >= 0, "socket");
+        int enable = 1;
+        ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(loopback ? INADDR_LOOPBACK : INADDR_ANY);
+        check(::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0, "bind");
+        check(::listen(listener, SOMAXCONN) == 0, "listen");
+        return listener;
+    }
+
+    static int connect(const endpoint_t &endpoint) {
+        addrinfo hints{};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *addresses = nullptr;
+        if (::getaddrinfo(endpoint.host.c_str(), std::to_string(endpoint.port).c_str(), &hints, &addresses) != 0) {
+            throw std::runtime_error("cannot resolve cluster host " + endpoint.host);
+        }
+        for (int attempt = 0; attempt < connect_attempts; ++attempt) {
+            auto socket = ::socket(AF_INET, SOCK_STREAM, 0);
+            check(socket >= 0, "socket");
+            if (::connect(socket, addresses->ai_addr, addresses->ai_addrlen) == 0) {
+                ::freeaddrinfo(addresses);
+                return socket;
+            }
+            ::close(socket);
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        ::freeaddrinfo(addresses);
+        throw std::runtime_error("cannot connect to cluster host " + endpoint.host);
+    }
+
+    static constexpr int connect_attempts = 600;
+
+    // Every process connects to the processes of lower rank and accepts the others, which introduce themselves
+    // with their rank.
+    void join(int listener, const std::vector<endpoint_t> &endpoints) {
+        auto processes = endpoints.size();
+        _sockets.assign(processes, -1);
+        for (std::size_t peer = 0; peer < _rank; ++peer) {
+            _sockets[peer] = connect(endpoints[peer]);
+            auto rank = static_cast<std::uint32_t>(_rank);
+            check(::send(_sockets[peer], &rank, sizeof(rank), MSG_NOSIGNAL) == sizeof(rank), "send");
+        }
+        for (std::size_t accepted = _rank + 1; accepted < processes; ++accepted) {
+            auto socket = ::accept(listener, nullptr, nullptr);
+            check(socket >= 0, "accept");
+            std::uint32_t rank;
+            check(::recv(socket, &rank, sizeof(rank), MSG_WAITALL) == sizeof(rank), "recv");
+            _sockets[rank] = socket;
+        }
+        ::close(listener);
+        for (auto socket: _sockets) {
+            if (socket < 0)
+                continue;
+            int enable = 1;
+            ::setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+            ::fcntl(socket, F_SETFL, ::fcntl(socket, F_GETFL) | O_NONBLOCK);
+        }
+        _outgoing.resize(processes);
+        _sent.assign(processes, 0);
+        _incoming.resize(processes);
+        _received.assign(processes, 0);
+        _ended.assign(processes, false);
+        _closed.assign(processes, false);
+        _markers.resize(processes);
+    }
+
+    bool roundComplete() const {
+        for (std::size_t peer = 0; peer < size(); ++peer) {
+            if (!_ended[peer] || _sent[peer] != _outgoing[peer].size())
+                return false;
+        }
+        return true;
+    }
+
+    // Handles the complete frames received from a peer, up to its round marker.
+    template<class HandlerF>
+    bool deliver(std::size_t peer, HandlerF &handle) {
+        auto &in = _incoming[peer];
+        auto &offset = _received[peer];
+        auto delivered = false;
+        while (!_ended[peer] && in.size() - offset >= header_size) {
+            std::uint32_t size;
+            frame kind;
+            auto data = reachability_detail::get(reachability_detail::get(in.data() + offset, size), kind);
+            if (in.size() - offset - header_size < size)
+                break;
+            offset += header_size + size;
+            if (kind == frame::round_end) {
+                _markers[peer].assign(data, data + size);
+                _ended[peer] = true;
+            } else {
+                handle(peer, kind, data, static_cast<std::size_t>(size));
+            }
+            delivered = true;
+        }
+        if (offset == in.size()) {
+            in.clear();
+            offset = 0;
+        } else if (offset > read_size) {
+            in.erase(in.begin(), in.begin() + static_cast<std::ptrdiff_t>(offset));
+            offset = 0;
+        }
+        return delivered;
+    }
+
+    template<class HandlerF>
+    void step(HandlerF &handle, bool block) {
+        auto delivered = false;
+        for (std::size_t peer = 0; peer < size(); ++peer) {
+            if (peer != _rank) {
+                delivered |= deliver(peer, handle);
+            }
+        }
+        _polled.clear();
+        _polledPeers.clear();
+        for (std::size_t peer = 0; peer < size(); ++peer) {
+            if (peer == _rank || _closed[peer])
+                continue;
+            short events = POLLIN;
+            if (_sent[peer] != _outgoing[peer].size())
+                events |= POLLOUT;
+            _polled.push_back(pollfd{_sockets[peer], events, 0});
+            _polledPeers.push_back(peer);
+        }
+        auto ready = ::poll(_polled.data(), _polled.size(), block && !delivered ? -1 : 0);
+        if (ready < 0 && errno == EINTR)
+            return;
+        check(ready >= 0, "poll");
+        for (std::size_t i = 0; i < _polled.size(); ++i) {
+            auto peer = _polledPeers[i];
+            if (_polled[i].revents & POLLOUT)
+                write(peer);
+            if (_polled[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                read(peer);
+                deliver(peer, handle);
+            }
+        }
+    }
+
+    void write(std::size_t peer) {
+        auto &out = _outgoing[peer];
+        auto sent = ::send(_sockets[peer], out.data() + _sent[peer], out.size() - _sent[peer], MSG_NOSIGNAL);
+        if (sent < 0) {
+            check(errno == EAGAIN || errno == EWOULDBLOCK, "send");
+            return;
+        }
+        _sent[peer] += static_cast<std::size_t>(sent);
+        if (_sent[peer] == out.size()) {
+            out.clear();
+            _sent[peer] = 0;
+        }
+    }
+
+    void read(std::size_t peer) {
+        auto &in = _incoming[peer];
+        auto size = in.size();
+        in.resize(size + read_size);
+        auto received = ::recv(_sockets[peer], in.data() + size, read_size, 0);
+        in.resize(size + static_cast<std::size_t>(std::max<ssize_t>(received, 0)));
+        // A process leaves once it has the markers of the last round, possibly before the others have all of them.
+        if (received == 0) {
+            if (!_ended[peer] || _received[peer] != in.size()) {
+                throw std::runtime_error("cluster process " + std::to_string(peer) + " closed the connection");
+            }
+            _closed[peer] = true;
+        }
+        if (received < 0) {
+            check(errno == EAGAIN || errno == EWOULDBLOCK, "recv");
+        }
+    }
+};
+#endif
+
+// Compact log of the exploration of a search, recorded with state_space_t::record. A search pops trace nodes from
+// its waiting list, checks them against the goal, expands those whose state was not passed yet and interns the
+// successors, each either as a new state or as a duplicate of an interned one. The log holds these events in the
+// order they happened, so state_space_t::replay repeats the same expansions and state pool accesses against the same
+// model without the waiting list, to reproduce a slow search under a profiler, and diff finds the first event where
+// two searches went different ways. Every event is a varint with its kind in the low two bits: a pop holds the zigzag
+// difference to the previous popped node and the goal flag, an expansion its number of successors and an interned
+// state 0 when new and otherwise how far its id lies behind the next new id. Most events take a byte.
+// The parallel breadth-first search interns the successors of a whole round together, so its log differs from that of
+// a single thread in where the states are interned. The sorted and distributed searches are not recorded.
+class search_log_t {
+public:
+    using node_t = trace_store_t::node_t;
+    static constexpr std::size_t no_event = static_cast<std::size_t>(-1);
+    static constexpr std::uint32_t version = 1;
+
+    enum class kind : std::uint8_t {
+        pop, expansion, state
+    };
+
+    // A decoded event. A pop has its node and goal flag, an expansion its number of successors and an interned state
+    // its id and whether it was a duplicate.
+    struct event_t {
+        search_log_t::kind kind;
+        std::uint64_t value;
+        bool flag;
+
+        bool operator==(const event_t &other) const {
+            return kind == other.kind && value == other.value && flag == other.flag;
+        }
+
+        bool operator!=(const event_t &other) const {
+            return !(*this == other);
+        }
+    };
+
+    struct summary_t {
+        std::size_t pops = 0;
+        std::size_t goals = 0;
+        std::size_t expansions = 0;
+        std::size_t newStates = 0;
+        std::size_t duplicates = 0;
+    };
+
+    // The first event two logs differ in, no_event when they are the same.
+    struct difference_t {
+        std::size_t event = no_event;
+        std::string first;
+        std::string second;
+    };
+
+    void pop(node_t node, bool goal) {
+        auto delta = static_cast<std::int64_t>(node) - static_cast<std::int64_t>(_lastNode);
+        auto zigzag = (static_cast<std::uint64_t>(delta) << 1) ^ static_cast<std::uint64_t>(delta >> 63);
+        putVarint(zigzag << 3 | std::uint64_t{goal} << 2 | static_cast<std::uint64_t>(kind::pop));
+        _lastNode = node;
+        ++_summary.pops;
+        _summary.goals += goal;
+    }
+
+    void expansion(std::size_t successors) {
+        putVarint(std::uint64_t{successors} << 2 | static_cast<std::uint64_t>(kind::expansion));
+        ++_summary.expansions;
+    }
+
+    // Logs the ids of a batch of interned states, of which the pool held size before the batch.
+    void interned(const std::vector<state_id_t> &ids, std::size_t count, std::size_t size) {
+        for (std::size_t i = 0; i < count; ++i) {
+            auto behind = ids[i] == size ? 0 : size - ids[i];
+            putVarint(std::uint64_t{behind} << 2 | static_cast<std::uint64_t>(kind::state));
+            if (behind) {
+                ++_summary.duplicates;
+            } else {
+                ++_summary.newStates;
+                ++size;
+            }
+        }
+    }
+
+    const summary_t &summary() const {
+        return _summary;
+    }
+
+    std::size_t bytes() const {
+        return _bytes.size();
+    }
+
+    void clear() {
+        *this = search_log_t{};
+    }
+
+    // Decodes the events in order, calling f(event) with each until it returns false. Returns the number of events
+    // decoded.
+    template<class F>
+    std::size_t events(F &&f) const {
+        std::size_t count = 0, position = 0;
+        node_t node = 0;
+        // The initial state is interned before the search.
+        std::uint64_t size = 1;
+        while (position < _bytes.size()) {
+            std::uint64_t value = 0;
+            for (unsigned shift = 0; position < _bytes.size(); shift += 7) {
+                auto byte = _bytes[position++];
+                value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                    break;
+            }
+            event_t event{static_cast<kind>(value & 3), 0, false};
+            value >>= 2;
+            if (event.kind == kind::pop) {
+                auto zigzag = value >> 1;
+                node += static_cast<node_t>(static_cast<std::int64_t>(zigzag >> 1) ^
+                                            -static_cast<std::int64_t>(zigzag & 1));
+                event.value = node;
+                event.flag = value & 1;
+            } else if (event.kind == kind::expansion) {
+                event.value = value;
+            } else {
+                event.flag = value != 0;
+                event.value = value ? size - value : size++;
+            }
+            ++count;
+            if (!f(event))
+                break;
+        }
+        return count;
+    }
+
+    static std::string describe(const event_t &event) {
+        switch (event.kind) {
+            case kind::pop:
+                return "pop of node " + std::to_string(event.value) + (event.flag ? ", a goal" : "");
+            case kind::expansion:
+                return "expansion into " + std::to_string(event.value) + " successors";
+            case kind::state:
+                return (event.flag ? "duplicate of state " : "new state ") + std::to_string(event.value);
+        }
+        return {};
+    }
+
+    static difference_t diff(const search_log_t &first, const search_log_t &second) {
+        std::vector<event_t> events;
+        events.reserve(second._summary.pops * 2);
+        second.events([&events](const event_t &event) {
+            events.push_back(event);
+            return true;
+        });
+        difference_t result;
+        std::size_t index = 0;
+        first.events([&](const event_t &event) {
+            if (index == events.size() || event != events[index]) {
+                result.event = index;
+                result.first = describe(event);
+                result.second = index == events.size() ? "end of the search" : describe(events[index]);
+                return false;
+            }
+            ++index;
+            return true;
+        });
+        if (result.event == no_event && index < events.size()) {
+            result.event = index;
+            result.first = "end of the search";
+            result.second = describe(events[index]);
+        }
+        return result;
+    }
+
+    // Writes the log as the magic "PZSL", the 32-bit format version, the 64-bit number of bytes and the events.
+    void save(std::ostream &os) const {
+        std::vector<char> header;
+        header.insert(header.end(), {'P', 'Z', 'S', 'L'});
+        reachability_detail::put(header, version);
+        reachability_detail::put(header, static_cast<std::uint64_t>(_bytes.size()));
+        os.write(header.data(), static_cast<std::streamsize>(header.size()));
+        os.write(reinterpret_cast<const char *>(_bytes.data()), static_cast<std::streamsize>(_bytes.size()));
+    }
+
+    static search_log_t load(std::istream &is) {
+        char header[16];
+        std::uint32_t fileVersion;
+        std::uint64_t size;
+        if (!is.read(header, sizeof(header)) || std::memcmp(header, "PZSL", 4) != 0)
+            throw std::runtime_error("not a search log");
+        reachability_detail::get(reachability_detail::get(header + 4, fileVersion), size);
+        if (fileVersion != version)
+            throw std::runtime_error("unsupported search log version " + std::to_string(fileVersion));
+        search_log_t log;
+        log._bytes.resize(size);
+        if (!is.read(reinterpret_cast<char *>(log._bytes.data()), static_cast<std::streamsize>(size)))
+            throw std::runtime_error("truncated search log");
+        log.events([&log](const event_t &event) {
+            log._summary.pops += event.kind == kind::pop;
+            log._summary.goals += event.kind == kind::pop && event.flag;
+            log._summary.expansions += event.kind == kind::expansion;
+            log._summary.newStates += event.kind == kind::state && !event.flag;
+            log._summary.duplicates += event.kind == kind::state && event.flag;
+            return true;
+        });
+        return log;
+    }
+
+private:
+    std::vector<std::uint8_t> _bytes;
+    node_t _lastNode = 0;
+    summary_t _summary;
+
+    void putVarint(std::uint64_t value) {
+        for (; value >= 0x80; value >>= 7) {
+            _bytes.push_back(static_cast<std::uint8_t>(value | 0x80));
+        }
+        _bytes.push_back(static_cast<std::uint8_t>(value));
+    }
+};
+
+// The outcome of replaying a search log, see state_space_t::replay.
+struct search_replay_t {
+    std::size_t events = 0;
+    std::size_t goals = 0;
+    // The first event the model did not reproduce, search_log_t::no_event when all were reproduced.
+    std::size_t divergence = search_log_t::no_event;
+    std::string expected;
+    std::string found;
+};
+
+// Buffered output of traces. Text and states formatted by a user function are appended to a large buffer, which is
+// passed to the stream in a single write whenever it fills and when the writer is flushed or destroyed. Besides text,
+// traces are written in two formats for other programs to read, both streamed as the traces come:
+// - Binary results start with the magic "PZTR" and the 32-bit format version. Every trace is a record of its number
+//   of states and the number of bytes of its states, 32 bits each, followed by the states encoded with state_codec.
+//   binaryIndex() ends the results with the 64-bit offsets of all records, their number and the magic "PZIX", so a
+//   reader can also seek to any trace from the end. Integers are written in the byte order of the machine.
+// - JSON lines hold a line {"trace":index,"states":[...]} per trace. States are formatted as JSON values by a user
+//   function, by default enumerations and integers become numbers and containers arrays.
+class trace_writer_t {
+public:
+    static constexpr std::size_t default_capacity = 1 << 20;
+    static constexpr std::uint32_t binary_version = 1;
+
+    explicit trace_writer_t(std::ostream &os, std::size_t capacity = default_capacity)
+            : _os(os), _capacity(capacity) {
+        _buffer.reserve(capacity);
+    }
+
+    trace_writer_t(const trace_writer_t &) = delete;
+    trace_writer_t &operator=(const trace_writer_t &) = delete;
+
+    ~trace_writer_t() {
+        flush();
+    }
+
+    void flush() {
+        if (!_buffer.empty()) {
+            _os.write(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+            _written += _buffer.size();
+            _buffer.clear();
+        }
+        _os.flush();
+    }
+
+    // The number of traces written.
+    std::size_t traces() const {
+        return _traces;
+    }
+
+    trace_writer_t &write(const char *data, std::size_t size) {
+        _buffer.insert(_buffer.end(), data, data + size);
+        spill();
+        return *this;
+    }
+
+    trace_writer_t &operator<<(char c) {
+        _buffer.push_back(c);
+        spill();
+        return *this;
+    }
+
+    trace_writer_t &operator<<(const char *text) {
+        return write(text, std::strlen(text));
+    }
+
+    trace_writer_t &operator<<(const std::string &text) {
+        return write(text.data(), text.size());
+    }
+
+    template<class IntegerT, typename = std::enable_if_t<std::is_integral<IntegerT>::value>>
+    trace_writer_t &operator<<(IntegerT value) {
+        if (static_cast<unsigned long long>(value) < 10)
+            return *this << static_cast<char>('0' + value);
+        char digits[24];
+        auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+        return write(digits, static_cast<std::size_t>(end - digits));
+    }
+
+    // Writes the states of a trace, each formatted by format(writer, state) or format(writer, state, index) and
+    // followed by a line break.
+    template<class TraceT, class FormatF>
+    void trace(const TraceT &trace, FormatF &&format) {
+        ++_traces;
+        std::size_t index = 0;
+        for (auto &state: trace) {
+            if constexpr (std::is_invocable<FormatF &, trace_writer_t &, decltype(state), std::size_t>::value) {
+                format(*this, state, index++);
+            } else {
+                format(*this, state);
+            }
+            *this << '\n';
+        }
+    }
+
+    // Writes the record of a trace in the binary format.
+    template<class TraceT>
+    void binaryTrace(const TraceT &trace) {
+        binaryHeader();
+        _offsets.push_back(_written + _buffer.size());
+        ++_traces;
+        state_codec<std::decay_t<decltype(*std::begin(trace))>> codec;
+        reachability_detail::put(_buffer, static_cast<std::uint32_t>(std::distance(std::begin(trace),
+                                                                                   std::end(trace))));
+        auto bytes = _buffer.size();
+        reachability_detail::put(_buffer, std::uint32_t{0});
+        for (auto &state: trace) {
+            codec.encode(state, _buffer);
+        }
+        auto size = static_cast<std::uint32_t>(_buffer.size() - bytes - sizeof(std::uint32_t));
+        std::memcpy(_buffer.data() + bytes, &size, sizeof(size));
+        spill();
+    }
+
+    // Ends binary results with the offsets of their records.
+    void binaryIndex() {
+        binaryHeader();
+        for (auto offset: _offsets) {
+            reachability_detail::put(_buffer, offset);
+        }
+        reachability_detail::put(_buffer, static_cast<std::uint64_t>(_offsets.size()));
+        write("PZIX", 4);
+    }
+
+    // Writes a trace as a JSON line, with the states formatted by format(writer, state).
+    template<class TraceT, class FormatF>
+    void jsonTrace(const TraceT &trace, FormatF &&format) {
+        *this << "{\"trace\":" << _traces++ << ",\"states\":[";
+        auto first = true;
+        for (auto &state: trace) {
+            if (!first)
+                *this << ',';
+            first = false;
+            format(*this, state);
+        }
+        *this << "]}\n";
+    }
+
+    template<class TraceT>
+    void jsonTrace(const TraceT &trace) {
+        jsonTrace(trace, [](trace_writer_t &out, const auto &state) { out.json(state); });
+    }
+
+    // Writes a value as JSON: enumerations and integers as numbers, booleans as true or false and containers as
+    // arrays of their elements.
+    template<class T>
+    trace_writer_t &json(const T &value) {
+        if constexpr (std::is_same<T, bool>::value) {
+            return *this << (value ? "true" : "false");
+        } else if constexpr (std::is_enum<T>::value) {
+            return json(static_cast<std::underlying_type_t<T>>(value));
+        } else if constexpr (std::is_integral<T>::value) {
+            // Widened, so characters are written as numbers too.
+            return *this << static_cast<std::conditional_t<std::is_signed<T>::value, long long, unsigned long long>>(
+                    value);
+        } else {
+            *this << '[';
+            auto first = true;
+            for (auto &&element: value) {
+                if (!first)
+                    *this << ',';
+                first = false;
+                json(element);
+            }
+            return *this << ']';
+        }
+    }
+
+private:
+    std::ostream &_os;
+    std::size_t _capacity;
+    std::vector<char> _buffer;
+    // Bytes passed to the stream so far, and the offsets of the binary records.
+    std::uint64_t _written = 0;
+    std::vector<std::uint64_t> _offsets;
+    bool _binary = false;
+    std::size_t _traces = 0;
+
+    void binaryHeader() {
+        if (!_binary) {
+            _binary = true;
+            write("PZTR", 4);
+            reachability_detail::put(_buffer, binary_version);
+        }
+    }
+
+    void spill() {
+        if (_buffer.size() >= _capacity) {
+            _os.write(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+            _written += _buffer.size();
+            _buffer.clear();
+        }
+    }
+};
+
+// Closed list of a cost search pruning dominated nodes, see state_space_t::dominance. A node is a state reached at a
+// cost, described by a key and by up to max_fields numbers where lower is better. A node dominates the nodes of its
+// key which are no better in any field. Every key keeps only the fields of its nodes dominated by no other, usually a
+// handful, so a generated node is compared with those of its key alone.
+class dominance_index_t {
+public:
+    static constexpr std::size_t max_fields = 4;
+    using fields_t = std::array<std::int64_t, max_fields>;
+
+    // Returns false if a kept node of the key dominates the fields, otherwise keeps the fields and drops the kept
+    // nodes they dominate.
+    bool insert(std::uint64_t key, const fields_t &fields) {
+        auto &front = _fronts[key];
+        for (auto &kept: front) {
+            if (dominates(kept, fields))
+                return false;
+        }
+        std::size_t size = 0;
+        for (std::size_t i = 0; i < front.size(); ++i) {
+            if (!dominates(fields, front[i]))
+                front[size++] = front[i];
+        }
+        while (front.size() > size) {
+            front.pop_back();
+        }
+        front.push_back(fields);
+        return true;
+    }
+
+    static bool dominates(const fields_t &a, const fields_t &b) {
+        for (std::size_t i = 0; i < max_fields; ++i) {
+            if (a[i] > b[i])
+                return false;
+        }
+        return true;
+    }
+
+private:
+    std::unordered_map<std::uint64_t, small_vector<fields_t, 2>> _fronts;
+};
+
+// Tuning of the depth-first search, whose moves are ordered by state_space_t::heuristic and state_space_t::history.
+struct depth_first_policy {
+    // Stops at the first goal found instead of reporting the traces to all goals. The shared search does not stop.
+    static inline bool firstSolution = false;
+};
+
+// Tuning of the iterative deepening search, see search_order::iterative_deepening. The search keeps only the path to
+// the current state instead of every passed state. It runs depth-first search with the bounds 0, 1, 2 and so on, and
+// reports the first goal found, which is reached by a shortest trace. It ends without a trace once a bound cuts off no
+// state, or after maxDepth. A state failing to reach a goal within the depth left to it is remembered in a nogood
+// table, so the states of a failed subtree are skipped when rediscovered through another path or by a later bound
+// with no more depth left. The search is not recorded to a search log.
+struct deepening_search_policy {
+    // Largest depth bound, 0 deepens without a limit. A space with cycles and no reachable goal is only left at this
+    // bound.
+    static inline std::size_t maxDepth = 0;
+    // Entries of the nogood table, 0 disables it.
+    static inline std::size_t nogoods = std::size_t{1} << 14;
+};
+
+// Bounded transposition table of the states from which an iterative deepening search found no goal, each with the
+// depth it had left then. Rediscovering such a state with no more depth left cannot reach a goal either. A failure
+// which no bound cut off holds for any depth and is stored as unbounded. Every hash maps to a bucket of two entries:
+// one keeps the largest failed budget, which saved the most work, and the other takes the latest failure.
+template<class StateT, class HashT = state_hash<StateT>>
+class nogood_table_t {
+public:
+    static constexpr std::size_t unbounded = SIZE_MAX;
+
+    explicit nogood_table_t(std::size_t entries) {
+        std::size_t buckets = 1;
+        while (buckets * 2 < entries) {
+            buckets *= 2;
+        }
+        if (entries)
+            _buckets.resize(buckets);
+    }
+
+    std::uint64_t hash(const StateT &state) const {
+        return reachability_detail::mix(_hash(state));
+    }
+
+    // The depth left when the state failed, or nothing if the table does not hold it.
+    std::optional<std::size_t> budget(const StateT &state, std::uint64_t hash) {
+        if (_buckets.empty())
+            return std::nullopt;
+        ++_lookups;
+        auto &bucket = _buckets[hash & (_buckets.size() - 1)];
+        for (auto entry: {&bucket.deep, &bucket.recent}) {
+            if (entry->used && entry->hash == hash && equal(entry->state, state)) {
+                ++_hits;
+                return entry->budget;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void store(const StateT &state, std::uint64_t hash, std::size_t budget) {
+        if (_buckets.empty())
+            return;
+        auto &bucket = _buckets[hash & (_buckets.size() - 1)];
+        for (auto entry: {&bucket.deep, &bucket.recent}) {
+            if (entry->used && entry->hash == hash && equal(entry->state, state)) {
+                entry->budget = std::max(entry->budget, budget);
+                return;
+            }
+        }
+        if (!bucket.deep.used || budget >= bucket.deep.budget) {
+            if (bucket.deep.used)
+                std::swap(bucket.deep, bucket.recent);
+            assign(bucket.deep, state, hash, budget);
+        } else {
+            assign(bucket.recent, state, hash, budget);
+        }
+    }
+
+    std::size_t lookups() const {
+        return _lookups;
+    }
+
+    std::size_t hits() const {
+        return _hits;
+    }
+
+private:
+    struct entry_t {
+        std::uint64_t hash = 0;
+        std::size_t budget = 0;
+        bool used = false;
+        StateT state;
+    };
+
+    struct bucket_t {
+        entry_t deep, recent;
+    };
+
+    bool equal(const StateT &a, const StateT &b) const {
+        return reachability_detail::states_equal(_hash, a, b, reachability_detail::priority<1>{});
+    }
+
+    static void assign(entry_t &entry, const StateT &state, std::uint64_t hash, std::size_t budget) {
+        entry.hash = hash;
+        entry.budget = budget;
+        entry.used = true;
+        entry.state = state;
+    }
+
+    HashT _hash;
+    std::vector<bucket_t> _buckets;
+    std::size_t _lookups = 0;
+    std::size_t _hits = 0;
+};
+
+// The state space class, uses a template class ContainerT to support any iterable container. (Requirement 7)
+// HashT hashes states for the state pool, see state_hash for the default.
+template<class StateT, template<class...> class ContainerT, class CostT = std::nullptr_t,
+        class HashT = state_hash<StateT>>
+class state_space_t {
+private:
+    StateT _initialState;
+    CostT _initialCost;
+    std::function<transitions_t<StateT>(StateT &)> _transitionFunction;
+    std::function<bool(const StateT &)> _invariantFunction;
+    bool _useCost = false;
+    std::function<CostT(const StateT &state, const CostT &cost)> _costFunction;
+    search_log_t *_log = nullptr;
+    std::shared_ptr<shared_graph_t<StateT, HashT>> _graph;
+    // The dominance of the cost search, see dominance.
+    std::function<std::uint64_t(const StateT &)> _dominanceKey;
+    std::function<dominance_index_t::fields_t(const StateT &, const CostT &)> _dominanceFields;
+    // The objectives of the Pareto search, see pareto.
+    std::function<dominance_index_t::fields_t(const StateT &, const CostT &)> _paretoObjectives;
+    // The move ordering of depth-first search, see heuristic and history. _history counts the goal traces taking each
+    // kind of transition.
+    std::function<std::int64_t(const StateT &)> _heuristic;
+    std::function<std::size_t(const StateT &, const StateT &)> _historyKind;
+    std::vector<std::uint64_t> _history;
+    // The filters of the workers of the last parallel search, see filterStatistics.
+    filter_statistics_t _filtered;
+
+    // Number of waiting states a breadth-first search expands before interning their successors together.
+    static constexpr std::size_t expansion_block = 64;
+
+    // The solvers pass every trace to report as soon as its goal state is found.
+    template<class ValidationF, class ReportF>
+    void solver(ValidationF isGoalState, search_order searchOrder, ReportF &report);
+
+    template<class ValidationF, class ReportF>
+    void costSolver(ValidationF isGoalState, ReportF &report);
+
+    template<class ValidationF, class ReportF>
+    void paretoSolver(ValidationF isGoalState, ReportF &report);
+
+    template<class ValidationF, class ReportF>
+    void sortedSolver(ValidationF isGoalState, ReportF &report);
+
+    template<class ValidationF, class ReportF>
+    void deepeningSolver(ValidationF isGoalState, ReportF &report);
+
+    // Number of states a round of the parallel breadth-first search expands on each thread, see
+    // parallel_search_policy. The cost search takes expansion_block states per thread, as a cheaper successor sends
+    // the rest of its round back to the queue.
+    static constexpr std::size_t parallel_expansions = 256;
+
+    // The successors a worker of a parallel search generates in a round, with their costs, hashes and the ids of
+    // those already interned, in buffers bound to the NUMA node of the worker, see reachability_detail::worker_pool_t.
+    // The successors of every state the worker expands are appended and read back by the calling thread by offset, so
+    // the buffers are reused from round to round and a worker never writes to memory of another node.
+    struct alignas(64) worker_scratch_t {
+        // Direct-mapped cache of the successors the worker found interned, see resolve. A worker mostly rediscovers
+        // states it has just seen, such as the state it came from, and finds their ids here without probing the
+        // slots of the pool. A slot is only taken if the pooled state of its id equals the one looked up.
+        struct filter_slot_t {
+            std::uint64_t hash = 0;
+            state_id_t id = state_pool_t<StateT, HashT>::no_state;
+        };
+        static constexpr std::size_t filter_slots = 1024;
+
+        std::vector<StateT, large_table_allocator<StateT>> successors;
+        std::vector<CostT, large_table_allocator<CostT>> costs;
+        std::vector<std::uint64_t, large_table_allocator<std::uint64_t>> hashes;
+        std::vector<state_id_t, large_table_allocator<state_id_t>> ids;
+        std::vector<filter_slot_t> filter;
+        std::size_t used = 0;
+        filter_statistics_t filtered;
+
+        explicit worker_scratch_t(int node)
+                : successors(large_table_allocator<StateT>{node}), costs(large_table_allocator<CostT>{node}),
+                  hashes(large_table_allocator<std::uint64_t>{node}), ids(large_table_allocator<state_id_t>{node}) {}
+    };
+
+    // Where the successors of a state expanded in a round are, see worker_scratch_t.
+    struct scratch_range_t {
+        std::size_t worker = 0;
+        std::size_t offset = 0;
+        std::size_t count = 0;
+    };
+
+    static std::vector<worker_scratch_t> workerScratch(const reachability_detail::worker_pool_t &workers) {
+        std::vector<worker_scratch_t> scratch;
+        for (std::size_t worker = 0; worker < workers.size(); ++worker) {
+            scratch.emplace_back(workers.node(worker));
+        }
+        return scratch;
+    }
+
+    // Hashes the successors of a range on the worker which generated them and looks them up, in the filter of the
+    // worker first and then in the pool, which is only read while a round expands. The calling thread then only
+    // interns the successors found in neither, see internRange.
+    static void resolve(const state_pool_t<StateT, HashT> &states, worker_scratch_t &buffers,
+                        const scratch_range_t &range) {
+        auto end = range.offset + range.count;
+        if (buffers.hashes.size() < end) {
+            buffers.hashes.resize(end);
+            buffers.ids.resize(end);
+        }
+        if (buffers.filter.empty())
+            buffers.filter.resize(worker_scratch_t::filter_slots);
+        for (auto i = range.offset; i < end; ++i) {
+            auto &successor = buffers.successors[i];
+            auto hash = states.hash(successor);
+            auto &slot = buffers.filter[hash & (worker_scratch_t::filter_slots - 1)];
+            buffers.hashes[i] = hash;
+            ++buffers.filtered.lookups;
+            if (slot.id != state_pool_t<StateT, HashT>::no_state && slot.hash == hash &&
+                states.holds(slot.id, successor)) {
+                ++buffers.filtered.hits;
+                buffers.ids[i] = slot.id;
+                continue;
+            }
+            buffers.ids[i] = states.find(successor, hash);
+            if (buffers.ids[i] != state_pool_t<StateT, HashT>::no_state)
+                slot = typename worker_scratch_t::filter_slot_t{hash, buffers.ids[i]};
+        }
+    }
+
+    // Interns the successors of a resolved range into ids, in order. The successors found by resolve keep their ids
+    // and the others are interned with the hashes of the worker, which assigns the ids internBatch would.
+    static void internRange(state_pool_t<StateT, HashT> &states, const worker_scratch_t &buffers,
+                            const scratch_range_t &range, state_id_t *ids) {
+        for (std::size_t j = 0; j < range.count; ++j) {
+            auto i = range.offset + j;
+            ids[j] = buffers.ids[i] != state_pool_t<StateT, HashT>::no_state
+                     ? buffers.ids[i] : states.intern(buffers.successors[i], buffers.hashes[i]).first;
+        }
+    }
+
+    // Sums the filter statistics of the workers of a finished parallel search, see filterStatistics.
+    void filtered(const std::vector<worker_scratch_t> &scratch) {
+        _filtered = filter_statistics_t{};
+        for (auto &buffers: scratch) {
+            _filtered.lookups += buffers.filtered.lookups;
+            _filtered.hits += buffers.filtered.hits;
+        }
+    }
+
+    template<class ValidationF, class ReportF>
+    void parallelSolver(ValidationF isGoalState, std::size_t threads, ReportF &report);
+
+    template<class ValidationF, class ReportF>
+    void parallelCostSolver(ValidationF isGoalState, std::size_t threads, ReportF &report);
+
+    template<class ValidationF, class ReportF>
+    void pipelineSolver(ValidationF isGoalState, ReportF &report);
+
+    template<class ValidationF, class ReportF>
+    void sharedSolver(ValidationF isGoalState, search_order order, ReportF &report);
+
+    template<class ValidationF, class ReportF>
+    void sharedCostSolver(ValidationF isGoalState, ReportF &report);
+
+    // The successors of a state in the shared graph, expanding it unless a query already did. The successors are
+    // interned through the filter of the query.
+    void sharedSuccessors(state_id_t id, std::vector<StateT> &successors, std::vector<state_id_t> &ids,
+                          typename shared_graph_t<StateT, HashT>::filter_t &filter) {
+        if (_graph->successors(id, ids))
+            return;
+        auto count = expand((*_graph)[id], successors);
+        ids.resize(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            ids[i] = _graph->intern(successors[i], filter).first;
+        }
+        _graph->expanded(id, ids);
+    }
+
+    // Wraps a function returning an array of up to dominance_index_t::max_fields numbers, padded with zeros.
+    template<class FieldsF>
+    static std::function<dominance_index_t::fields_t(const StateT &, const CostT &)> fieldsOf(FieldsF fields) {
+        return [fields = std::move(fields)](const StateT &state, const CostT &cost) {
+            auto values = fields(state, cost);
+            static_assert(std::tuple_size<decltype(values)>::value <= dominance_index_t::max_fields,
+                          "At most dominance_index_t::max_fields fields are compared.");
+            dominance_index_t::fields_t result{};
+            for (std::size_t i = 0; i < values.size(); ++i) {
+                result[i] = static_cast<std::int64_t>(values[i]);
+            }
+            return result;
+        };
+    }
+
+    // A successor ranked by the move ordering of depth-first search.
+    struct move_t {
+        std::int64_t heuristic;
+        std::uint64_t history;
+        std::size_t index;
+    };
+
+    // Ranks the successors of a state from the last to the first to explore, as depth-first search pops the last
+    // pushed node first.
+    void orderMoves(const StateT &state, const StateT *successors, std::size_t count, std::vector<move_t> &moves) {
+        moves.resize(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            moves[i].heuristic = _heuristic ? _heuristic(successors[i]) : 0;
+            moves[i].history = 0;
+            if (_historyKind) {
+                auto kind = _historyKind(state, successors[i]);
+                if (kind < _history.size())
+                    moves[i].history = _history[kind];
+            }
+            moves[i].index = i;
+        }
+        std::stable_sort(moves.begin(), moves.end(), [](const move_t &a, const move_t &b) {
+            if (a.heuristic != b.heuristic)
+                return a.heuristic > b.heuristic;
+            return a.history < b.history;
+        });
+    }
 
-// The state space class, uses a template class ContainerT to support any iterable container. (Requirement 7)
-template<class StateT, template<class...> class ContainerT, class CostT = std::nullptr_t>
-class state_space_t {
-private:
-    StateT _initialState;
-    CostT _initialCost;
-    std::function<ContainerT<std::function<void(StateT &)>>(StateT &)> _transitionFunction;
-    std::function<bool(const StateT &)> _invariantFunction;
-    bool _useCost = false;
-    std::function<CostT(const StateT &state, const CostT &cost)> _costFunction;
+    // Counts the kinds of the transitions of a goal trace in the history.
+    template<class TraceT>
+    void credit(const TraceT &trace) {
+        auto from = std::begin(trace);
+        if (from == std::end(trace))
+            return;
+        for (auto to = std::next(from); to != std::end(trace); from = to++) {
+            auto kind = _historyKind(*from, *to);
+            if (kind < _history.size())
+                ++_history[kind];
+        }
+    }
+
+    // Moves the successors not dominated by the nodes of the index to the front and returns their number.
+    std::size_t prune(dominance_index_t &dominance, std::vector<StateT> &successors, std::vector<CostT> &costs,
+                      std::size_t count) const {
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (dominance.insert(_dominanceKey(successors[i]), _dominanceFields(successors[i], costs[i]))) {
+                if (kept != i) {
+                    std::swap(successors[kept], successors[i]);
+                    std::swap(costs[kept], costs[i]);
+                }
+                ++kept;
+            }
+        }
+        return kept;
+    }
+
+    // Applies the transitions to a copy of a state and keeps the successors satisfying the invariant in successors from
+    // first on, whose states are reused. Returns the number of successors kept.
+    template<class AllocatorT>
+    std::size_t expand(const StateT &state, std::vector<StateT, AllocatorT> &successors, std::size_t first = 0) const {
+        auto currentState = state;
+        auto transitions = _transitionFunction(currentState);
+        auto generated = first;
+        for (auto &transition: transitions) {
+            if (generated == successors.size()) {
+                successors.push_back(currentState);
+            } else {
+                successors[generated] = currentState;
+            }
+            transition(successors[generated]);
+            if (_invariantFunction(successors[generated])) {
+                ++generated;
+            }
+        }
+        return generated - first;
+    }
+
+#ifdef __linux__
+    // A goal node of a distributed search with the round it was reached in, which orders the reported traces.
+    struct distributed_goal_t {
+        distributed_trace_store_t::node_t node;
+        std::uint32_t round;
+    };
 
     template<class ValidationF>
-    ContainerT<ContainerT<StateT>> solver(ValidationF isGoalState, search_order searchOrder);
+    ContainerT<ContainerT<StateT>> distributedSolver(ValidationF isGoalState, cluster_t &cluster);
 
     template<class ValidationF>
-    ContainerT<ContainerT<StateT>> costSolver(ValidationF isGoalState);
+    ContainerT<ContainerT<StateT>> distributedCostSolver(ValidationF isGoalState, cluster_t &cluster);
 
+    ContainerT<ContainerT<StateT>> distributedTraces(cluster_t &cluster, const state_pool_t<StateT, HashT> &states,
+                                                     const distributed_trace_store_t &traces,
+                                                     const std::vector<distributed_goal_t> &goals);
+#endif
 
 public:
     // Default constructor with no cost
     state_space_t(
             const StateT initialState,
-            std::function<ContainerT<std::function<void(StateT &)>>(StateT &)> transitionFunction,
+            successor_generator_t<StateT, ContainerT> transitionFunction,
             // Default value is a function that takes a const state and returns true.
-            bool (*invariantFunction)(const StateT &) = [](const StateT &state) { return true; }
+            typename reachability_detail::identity<std::function<bool(const StateT &)>>::type invariantFunction =
+                    [](const StateT &state) { return true; }
     ) {
         _initialState = initialState;
-        _transitionFunction = transitionFunction;
-        _invariantFunction = invariantFunction;
+        _transitionFunction = std::move(transitionFunction.generate);
+        _invariantFunction = std::move(invariantFunction);
         _useCost = false;
 
         // Fail if arguments are of wrong types (Requirement 9)
         static_assert(std::is_class<StateT>::value, "StateT must be struct or class.");
     };
 
-    // Constructor with cost enabled
-    template<typename lambda>
-    state_space_t(
-            const StateT initialState,
-            const CostT initialCost,
-            std::function<ContainerT<std::function<void(StateT &)>>(StateT &)> transitionFunction,
-            bool (*invariantFunction)(const StateT &) = [](const StateT &s) { return true; },
-            lambda costFunction = [](const StateT &s, const CostT &c) { return CostT{0, 0}; }
-    ) {
-        // Fail if arguments are of wrong types (Requirement 9)
-        // It is enough to check if StateT and CostT are classes, as it also captures structs.
-        static_assert(std::is_class<StateT>::value, "StateT must be a class or struct.");
-        static_assert(std::is_class<CostT>::value, "CostT must be a class or struct.");
-        static_assert(std::is_convertible<lambda, std::function<CostT(const StateT &, const CostT &)>>::value,
-                      "Cost function must be a function, that can be converted to function<CostT (const StateT&, const CostT&)>>");
+    // Constructor with cost enabled
+    template<typename lambda>
+    state_space_t(
+            const StateT initialState,
+            const CostT initialCost,
+            successor_generator_t<StateT, ContainerT> transitionFunction,
+            typename reachability_detail::identity<std::function<bool(const StateT &)>>::type invariantFunction =
+                    [](const StateT &s) { return true; },
+            lambda costFunction = [](const StateT &s, const CostT &c) { return CostT{0, 0}; }
+    ) {
+        // Fail if arguments are of wrong types (Requirement 9)
+        // It is enough to check if StateT and CostT are classes, as it also captures structs.
+        static_assert(std::is_class<StateT>::value, "StateT must be a class or struct.");
+        static_assert(std::is_class<CostT>::value, "CostT must be a class or struct.");
+        static_assert(std::is_convertible<lambda, std::function<CostT(const StateT &, const CostT &)>>::value,
+                      "Cost function must be a function, that can be converted to function<CostT (const StateT&, const CostT&)>>");
+
+        _initialState = initialState;
+        _initialCost = initialCost;
+        _transitionFunction = std::move(transitionFunction.generate);
+        _invariantFunction = std::move(invariantFunction);
+        _costFunction = costFunction;
+        _useCost = true;
+    }
+
+    // The function to call the solver, default search order is breadth_first, as a reasonable choice as defined in
+    // requirement 8.
+    template<class ValidationF>
+    ContainerT<ContainerT<StateT>> check(
+            ValidationF isGoalState,
+            search_order order = search_order::breadth_first) {
+        ContainerT<ContainerT<StateT>> result;
+        check(isGoalState, [&result](ContainerT<StateT> &&trace) { result.push_back(std::move(trace)); }, order);
+        return result;
+    }
+
+    // Streams the traces instead of returning them: report(trace) is called with every trace as soon as its goal
+    // state is found, so consumers can write out millions of traces without holding them. Returns the number of
+    // traces.
+    // Once shareGraph has been called, any number of threads may call check at once, each with its own goal and
+    // report functions.
+    template<class ValidationF, class ReportF,
+            typename = std::enable_if_t<std::is_invocable<ReportF &, ContainerT<StateT> &&>::value>>
+    std::size_t check(
+            ValidationF isGoalState,
+            ReportF &&report,
+            search_order order = search_order::breadth_first) {
+        std::size_t count = 0;
+        auto counted = [&report, &count](ContainerT<StateT> &&trace) {
+            ++count;
+            report(std::move(trace));
+        };
+
+        auto threads = reachability_detail::search_threads();
+        // Queries of a shared graph run at once and never take the parallel searches.
+        if (!_graph)
+            _filtered = filter_statistics_t{};
+        // The cost solver can only be instantiated when a cost type is given.
+        if constexpr (!std::is_same<CostT, std::nullptr_t>::value) {
+            if (_useCost) {
+                if (_paretoObjectives)
+                    paretoSolver(isGoalState, counted);
+                else if (_dominanceKey)
+                    costSolver(isGoalState, counted);
+                else if (_graph)
+                    sharedCostSolver(isGoalState, counted);
+                else if (threads > 1)
+                    parallelCostSolver(isGoalState, threads, counted);
+                else
+                    costSolver(isGoalState, counted);
+                return count;
+            }
+        }
+        if (order == search_order::iterative_deepening) {
+            deepeningSolver(isGoalState, counted);
+            return count;
+        }
+        if (order == search_order::sorted_breadth_first) {
+            if constexpr (reachability_detail::has_codec<StateT>::value) {
+                sortedSolver(isGoalState, counted);
+                return count;
+            }
+            std::cout << "Sorted breadth-first search needs a state_codec for the state type.";
+            return count;
+        }
+        if (_graph) {
+            sharedSolver(isGoalState, order, counted);
+            return count;
+        }
+        if (pipeline_search_policy::generators && order == search_order::breadth_first) {
+            pipelineSolver(isGoalState, counted);
+            return count;
+        }
+        if (threads > 1 && order == search_order::breadth_first) {
+            parallelSolver(isGoalState, threads, counted);
+            return count;
+        }
+        solver(isGoalState, order, counted);
+        return count;
+    }
+
+    // Makes the following searches explore a graph shared by all of them, so threads can search this space at once
+    // and a state is expanded once for all searches, see shared_graph_t. The transition, invariant and cost functions
+    // are then called concurrently and must not modify shared data. The graph is kept until the space and its copies
+    // are destroyed, and the shared searches are not recorded to a search log. The sorted search keeps its own layers.
+    void shareGraph() {
+        if (!_graph)
+            _graph = std::make_shared<shared_graph_t<StateT, HashT>>();
+    }
+
+    // The shared graph, nullptr unless shareGraph was called.
+    const shared_graph_t<StateT, HashT> *sharedGraph() const {
+        return _graph.get();
+    }
+
+    // Lookups and hits of the filters of the workers of the last search if it ran in parallel, breadth-first or by
+    // cost, see resolve. The pipelined search interns on the calling thread while its stages run, so its stages cannot
+    // look in the pool and have no filters.
+    filter_statistics_t filterStatistics() const {
+        return _filtered;
+    }
+
+    // Prunes dominated nodes from the following cost searches. key(state) returns a 64-bit key which is equal for
+    // exactly the states that may dominate each other, such as a packing of the state, and fields(state, cost)
+    // returns an array of up to dominance_index_t::max_fields numbers where lower is better. A generated node is
+    // discarded when a node of its key generated before is as good in every field, and is otherwise queued as usual.
+    // A goal reached again at no better cost is then not reported again, so a pruned search may report fewer traces.
+    // The pruned search runs on the calling thread, also for a shared graph or several threads.
+    template<class KeyF, class FieldsF>
+    void dominance(KeyF key, FieldsF fields) {
+        _dominanceKey = std::move(key);
+        _dominanceFields = fieldsOf(std::move(fields));
+    }
+
+    // Stops pruning dominated nodes.
+    void noDominance() {
+        _dominanceKey = nullptr;
+        _dominanceFields = nullptr;
+    }
+
+    // Makes the following cost searches find the Pareto-optimal traces of several objectives in one search instead of
+    // the cheapest traces by the order of the cost. objectives(state, cost) returns an array of up to
+    // dominance_index_t::max_fields numbers where lower is better, which must not decrease along a transition, such
+    // as the fields of a cost summing several measures. A trace is reported for every goal cost no other goal cost is
+    // as good as in every objective, one per such cost, in the lexicographic order of the objectives. Every state
+    // keeps the front of its costs no other cost of the state is as good as, and a goal is not expanded. The search
+    // runs on the calling thread and is not recorded to a search log.
+    template<class ObjectivesF>
+    void pareto(ObjectivesF objectives) {
+        _paretoObjectives = fieldsOf(std::move(objectives));
+    }
+
+    // Searches by the order of the cost again.
+    void noPareto() {
+        _paretoObjectives = nullptr;
+    }
+
+    // Orders the successors of a state in depth-first search, which explores the successors with the lowest
+    // heuristic(successor) first. Successors of equal heuristic are ordered by their history, see history, and then
+    // as generated. The states and trace nodes are still added in the order generated, so the search log replays.
+    // The shared search does not order its moves.
+    template<class HeuristicF>
+    void heuristic(HeuristicF heuristic) {
+        _heuristic = [heuristic = std::move(heuristic)](const StateT &state) {
+            return static_cast<std::int64_t>(heuristic(state));
+        };
+    }
+
+    // Keeps a history of the kinds of transitions, given by kind(state, successor) below kinds, taken by the traces
+    // to the goals. Depth-first search explores the successors of the kinds most often taken first, so transitions
+    // which led to goals in earlier searches of this space, or earlier in the same search, are tried first. Kinds
+    // from kinds on are not counted.
+    template<class KindF>
+    void history(KindF kind, std::size_t kinds) {
+        _historyKind = std::move(kind);
+        _history.assign(kinds, 0);
+    }
+
+    // Explores the successors as generated and forgets the history.
+    void noOrdering() {
+        _heuristic = nullptr;
+        _historyKind = nullptr;
+        _history.clear();
+    }
+
+    // Records the exploration of the following searches to a log, or stops recording when given nullptr. The log is
+    // appended to and must outlive the searches.
+    void record(search_log_t *log) {
+        _log = log;
+    }
+
+    // Repeats the expansions and state pool accesses of a recorded search, checking every event against the log. The
+    // goal predicate is evaluated on the popped states as by the search. Stops at the first event the model does not
+    // reproduce, such as a different number of successors.
+    template<class ValidationF>
+    search_replay_t replay(ValidationF isGoalState, const search_log_t &log);
+
+#ifdef __linux__
+    // Searches on all processes of a cluster together, each process expanding the states it owns, see cluster_t.
+    // Every process of the cluster has to call it. The traces are gathered on rank 0, the other processes return
+    // none. The search proceeds in rounds, so only breadth-first order and the cost order are supported.
+    template<class ValidationF>
+    ContainerT<ContainerT<StateT>> check(
+            ValidationF isGoalState,
+            cluster_t &cluster,
+            search_order order = search_order::breadth_first) {
+
+        if constexpr (!std::is_same<CostT, std::nullptr_t>::value) {
+            if (_useCost) {
+                return distributedCostSolver(isGoalState, cluster);
+            }
+        }
+        if (order != search_order::breadth_first) {
+            std::cout << "Distributed search only supports breadth-first order.";
+            return {};
+        }
+        return distributedSolver(isGoalState, cluster);
+    }
+#endif
+};
+
+// The default solver when cost is not involved
+template<class StateT, template<class...> class ContainerT, class CostT, class HashT>
+template<class ValidationF, class ReportF>
+void state_space_t<StateT, ContainerT, CostT, HashT>::solver(ValidationF isGoalState, search_order order,
+                                                             ReportF &report) {
+    StateT currentState;
+    trace_store_t::node_t traceState;
+    // Every generated state is interned once, the remaining structures only hold ids.
+    state_pool_t<StateT, HashT> states;
+    trace_store_t traces;
+    std::vector<bool> passed;
+    frontier_blocks_t waiting;
+    // Successors are generated into a block and interned together, see state_pool_t::internBatch.
+    std::vector<StateT> block;
+    std::vector<trace_store_t::node_t> blockParents;
+    std::vector<state_id_t> blockIds;
+    // Depth-first search expands one state per block, whose successors are pushed in the order of their moves.
+    auto ordered = order == search_order::depth_first && (_heuristic || _historyKind);
+    std::vector<trace_store_t::node_t> blockNodes;
+    std::vector<move_t> moves;
+
+    // Add the initial to waiting list to have a starting point
+    waiting.push_back(traces.add(trace_store_t::no_parent, states.intern(_initialState).first));
+
+    // Keep iterating through the waiting list until it is empty
+    while (!waiting.empty()) {
+        std::size_t generated = 0;
+        // Breadth-first search expands a whole block of waiting states before interning their successors. This
+        // explores in the same order, as the successors are appended behind the popped states anyway.
+        auto expansions = order == search_order::breadth_first ? expansion_block : 1;
+        for (std::size_t expansion = 0; expansion < expansions && !waiting.empty(); ++expansion) {
+            // Requirement 4: Support various search orders (BFS, DFS)
+            if (order == search_order::breadth_first) {
+                traceState = waiting.front();
+                waiting.pop_front();
+            } else if (order == search_order::depth_first) {
+                traceState = waiting.back();
+                waiting.pop_back();
+            } else {
+                std::cout << "Invalid search order supplied.";
+                return;
+            }
+            auto current = traces.state(traceState);
+            currentState = states[current];
+
+            // Requirement 2: Find a state satisfying the goal predicate
+            // Requirement 3: Each reconstructed trace holds a state sequence from initial to a goal state.
+            auto goal = isGoalState(currentState);
+            if (_log) {
+                _log->pop(traceState, goal);
+            }
+            if (goal) {
+                auto trace = traces.trace<ContainerT>(traceState, states);
+                if (_historyKind)
+                    credit(trace);
+                report(std::move(trace));
+                if (order == search_order::depth_first && depth_first_policy::firstSolution)
+                    return;
+            }
+
+            // Check if the state has already been passed to ensure that you don't re-visit it.
+            passed.resize(states.size());
+            if (!passed[current]) {
+                passed[current] = true;
+                auto transitions = _transitionFunction(currentState);
+                auto first = generated;
+
+                for (auto &transition: transitions) {
+                    // Reuse the block entries, so states owning memory keep their buffers between expansions.
+                    if (generated == block.size()) {
+                        block.push_back(currentState);
+                        blockParents.push_back(traceState);
+                    } else {
+                        block[generated] = currentState;
+                        blockParents[generated] = traceState;
+                    }
+                    transition(block[generated]);
+
+                    // Requirement 5: Support a given invariant predicate.
+                    if (_invariantFunction(block[generated])) {
+                        ++generated;
+                    }
+                }
+                if (_log) {
+                    _log->expansion(generated - first);
+                }
+            }
+        }
+
+        auto size = states.size();
+        states.internBatch(block.data(), generated, blockIds);
+        if (_log) {
+            _log->interned(blockIds, generated, size);
+        }
+        if (ordered) {
+            blockNodes.resize(generated);
+            for (std::size_t i = 0; i < generated; ++i) {
+                blockNodes[i] = traces.add(blockParents[i], blockIds[i]);
+            }
+            orderMoves(currentState, block.data(), generated, moves);
+            for (auto &move: moves) {
+                waiting.push_back(blockNodes[move.index]);
+            }
+            continue;
+        }
+        for (std::size_t i = 0; i < generated; ++i) {
+            waiting.push_back(traces.add(blockParents[i], blockIds[i]));
+        }
+    }
+}
+
+// Iterative deepening over an explicit path, see deepening_search_policy. A frame of the path holds a state, its
+// transitions and whether the bound cut off any state below it, in which case the state only failed within the depth
+// left to it.
+template<class StateT, template<class...> class ContainerT, class CostT, class HashT>
+template<class ValidationF, class ReportF>
+void state_space_t<StateT, ContainerT, CostT, HashT>::deepeningSolver(ValidationF isGoalState, ReportF &report) {
+    struct frame_t {
+        StateT state;
+        std::uint64_t hash = 0;
+        transitions_t<StateT> transitions;
+        std::size_t next = 0;
+        bool cut = false;
+    };
+    nogood_table_t<StateT, HashT> nogoods(deepening_search_policy::nogoods);
+    // The frames are kept between bounds, so states owning memory keep their buffers.
+    std::vector<frame_t> path(1);
+    auto goal = [&](std::size_t depth) {
+        if (!isGoalState(path[depth].state))
+            return false;
+        ContainerT<StateT> trace;
+        for (std::size_t i = 0; i <= depth; ++i) {
+            trace.push_back(path[i].state);
+        }
+        report(std::move(trace));
+        return true;
+    };
+
+    for (std::size_t bound = 0; !deepening_search_policy::maxDepth || bound <= deepening_search_policy::maxDepth;
+         ++bound) {
+        auto &root = path[0];
+        root.state = _initialState;
+        root.hash = nogoods.hash(root.state);
+        if (goal(0))
+            return;
+        root.cut = bound == 0;
+        root.transitions = bound ? _transitionFunction(root.state) : transitions_t<StateT>{};
+        root.next = 0;
+
+        std::size_t depth = 0;
+        while (true) {
+            if (path[depth].next < path[depth].transitions.size()) {
+                if (path.size() == depth + 1)
+                    path.emplace_back();
+                auto &frame = path[depth];
+                auto &child = path[depth + 1];
+                child.state = frame.state;
+                frame.transitions[frame.next++](child.state);
+                if (!_invariantFunction(child.state))
+                    continue;
+
+                // A state which failed with at least the depth left now is skipped. It only failed within that depth
+                // unless stored as unbounded, so a larger bound may still find a goal through it.
+                auto left = bound - depth - 1;
+                child.hash = nogoods.hash(child.state);
+                auto failed = nogoods.budget(child.state, child.hash);
+                if (failed && *failed >= left) {
+                    frame.cut |= *failed != nogood_table_t<StateT, HashT>::unbounded;
+                    continue;
+                }
+
+                ++depth;
+                if (goal(depth))
+                    return;
+                if (left == 0) {
+                    // The bound cuts off the successors, a state without depth left is not worth remembering.
+                    path[--depth].cut = true;
+                    continue;
+                }
+                child.transitions = _transitionFunction(child.state);
+                child.next = 0;
+                child.cut = false;
+            } else {
+                auto &frame = path[depth];
+                nogoods.store(frame.state, frame.hash,
+                              frame.cut ? bound - depth : nogood_table_t<StateT, HashT>::unbounded);
+                if (depth == 0)
+                    break;
+                path[--depth].cut |= frame.cut;
+            }
+        }
+        // No state was cut off, so a larger bound explores the same states.
+        if (!path[0].cut)
+            return;
+    }
+}
+
+// Requirement 6: Support a custom cost function over states.
+// This cost solver uses the cost rather than DFS or BFS for traversing the waiting list.
+template<class StateT, template<class...> class ContainerT, class CostT, class HashT>
+template<class ValidationF, class ReportF>
+void state_space_t<StateT, ContainerT, CostT, HashT>::costSolver(ValidationF isGoalState, ReportF &report) {
+    StateT currentState;
+    CostT currentCost;
+    currentCost = _initialCost;
+    trace_store_t::node_t traceState;
+    state_pool_t<StateT, HashT> states;
+    trace_store_t traces;
+    std::vector<bool> passed;
+    // The successors of one expansion are interned together, see state_pool_t::internBatch.
+    std::vector<StateT> block;
+    std::vector<CostT> blockCosts;
+    std::vector<state_id_t> blockIds;
+    // Equally cheap states are explored in breadth-first order, see reachability_detail::cost_order_t.
+    using entry_t = std::pair<CostT, trace_store_t::node_t>;
+    std::priority_queue<entry_t, std::vector<entry_t>, reachability_detail::cost_order_t<entry_t>> waiting;
+    dominance_index_t dominance;
+    if (_dominanceKey) {
+        dominance.insert(_dominanceKey(_initialState), _dominanceFields(_initialState, currentCost));
+    }
+
+    // Generate a set of cost and trace state to find the lowest cost aka where to go next
+    waiting.push(std::make_pair(currentCost, traces.add(trace_store_t::no_parent, states.intern(_initialState).first)));
+
+    while (!waiting.empty()) {
+        // Prepare to go to the next state, which is next in the queue
+        currentCost = waiting.top().first; // First element of pair is cost
+        traceState = waiting.top().second; // Second element is trace state
+        waiting.pop();
+        auto current = traces.state(traceState);
+        currentState = states[current];
+
+        auto goal = isGoalState(currentState);
+        if (_log) {
+            _log->pop(traceState, goal);
+        }
+        if (goal) {
+            report(traces.trace<ContainerT>(traceState, states));
+        }
+
+        // Check if current state has already been passed otherwise expand it
+        passed.resize(states.size());
+        if (passed[current]) {
+            continue;
+        }
+        passed[current] = true;
+        auto transitions = _transitionFunction(currentState);
+
+        std::size_t generated = 0;
+        for (auto &transition: transitions) {
+            if (generated == block.size()) {
+                block.push_back(currentState);
+                blockCosts.emplace_back();
+            } else {
+                block[generated] = currentState;
+            }
+            transition(block[generated]);
+
+            if (_invariantFunction(block[generated])) {
+                blockCosts[generated] = _costFunction(block[generated], currentCost);
+                ++generated;
+            }
+        }
+
+        // Dominated successors are dropped before interning, swapping keeps the buffers of their states.
+        auto kept = _dominanceKey ? prune(dominance, block, blockCosts, generated) : generated;
+
+        auto size = states.size();
+        states.internBatch(block.data(), kept, blockIds);
+        if (_log) {
+            _log->expansion(generated);
+            _log->interned(blockIds, kept, size);
+        }
+        for (std::size_t i = 0; i < kept; ++i) {
+            waiting.push(std::make_pair(blockCosts[i], traces.add(traceState, blockIds[i])));
+        }
+    }
+}
+
+// Multi-objective search, see pareto. A label is a trace node reached at a cost. The labels are popped in the
+// lexicographic order of their objectives, so a popped label is never dominated by a label popped later, as the
+// objectives do not decrease. A label dominated by a label of its state or by a goal found is dropped when generated,
+// and a waiting label is dropped when a new label of its state dominates it.
+template<class StateT, template<class...> class ContainerT, class CostT, class HashT>
+template<class ValidationF, class ReportF>
+void state_space_t<StateT, ContainerT, CostT, HashT>::paretoSolver(ValidationF isGoalState, ReportF &report) {
+    using fields_t = dominance_index_t::fields_t;
+    struct label_t {
+        fields_t objectives;
+        CostT cost;
+        trace_store_t::node_t node;
+        bool waiting;
+    };
+    state_pool_t<StateT, HashT> states;
+    trace_store_t traces;
+    std::vector<label_t> labels;
+    // The labels of every state dominated by no other label of the state.
+    std::vector<small_vector<std::size_t, 2>> fronts;
+    std::vector<fields_t> goals;
+    std::vector<StateT> successors;
+    std::vector<state_id_t> ids;
+    auto order = [&labels](std::size_t a, std::size_t b) {
+        if (labels[a].objectives != labels[b].objectives)
+            return labels[b].objectives < labels[a].objectives;
+        return a > b;
+    };
+    std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(order)> waiting{order};
+    auto dominated = [](const std::vector<fields_t> &front, const fields_t &objectives) {
+        for (auto &kept: front) {
+            if (dominance_index_t::dominates(kept, objectives))
+                return true;
+        }
+        return false;
+    };
+
+    auto initial = states.intern(_initialState).first;
+    labels.push_back({_paretoObjectives(_initialState, _initialCost), _initialCost,
+                      traces.add(trace_store_t::no_parent, initial), true});
+    fronts.resize(states.size());
+    fronts[initial].push_back(0);
+    waiting.push(0);
+
+    while (!waiting.empty()) {
+        auto popped = waiting.top();
+        waiting.pop();
+        if (!labels[popped].waiting)
+            continue;
+        labels[popped].waiting = false;
+        if (dominated(goals, labels[popped].objectives))
+            continue;
+        auto node = labels[popped].node;
+        auto current = states[traces.state(node)];
+        if (isGoalState(current)) {
+            goals.push_back(labels[popped].objectives);
+            report(traces.trace<ContainerT>(node, states));
+            continue;
+        }
+
+        auto count = expand(current, successors);
+        states.internBatch(successors.data(), count, ids);
+        fronts.resize(states.size());
+        for (std::size_t i = 0; i < count; ++i) {
+            auto cost = _costFunction(successors[i], labels[popped].cost);
+            auto objectives = _paretoObjectives(successors[i], cost);
+            if (dominated(goals, objectives))
+                continue;
+            auto &front = fronts[ids[i]];
+            auto kept = true;
+            for (auto label: front) {
+                if (dominance_index_t::dominates(labels[label].objectives, objectives)) {
+                    kept = false;
+                    break;
+                }
+            }
+            if (!kept)
+                continue;
+            // The new label can only dominate waiting labels, as a popped label is lexicographically smaller.
+            std::size_t size = 0;
+            for (std::size_t j = 0; j < front.size(); ++j) {
+                if (dominance_index_t::dominates(objectives, labels[front[j]].objectives))
+                    labels[front[j]].waiting = false;
+                else
+                    front[size++] = front[j];
+            }
+            while (front.size() > size) {
+                front.pop_back();
+            }
+            front.push_back(labels.size());
+            labels.push_back({objectives, std::move(cost), traces.add(node, ids[i]), true});
+            waiting.push(labels.size() - 1);
+        }
+    }
+}
+
+// Breadth-first search over packed layers, which detects duplicates by sorting instead of a state pool, see
+// packed_layers_t. The states are packed with state_codec and must all pack to the same size. Every generated state is
+// checked against the goal, so a goal is reported once for every expanded state reaching it, as by the default solver.
+template<class StateT, template<class...> class ContainerT, class CostT, class HashT>
+template<class ValidationF, class ReportF>
+void state_space_t<StateT, ContainerT, CostT, HashT>::sortedSolver(ValidationF isGoalState, ReportF &report) {
+    state_codec<StateT> codec;
+    StateT currentState, successor;
+    std::vector<char> encoded, unpacked;
+    codec.encode(_initialState, encoded);
+    packed_layers_t layers(encoded.size());
+    unpacked.resize(layers.width());
+    // Reports the trace to a goal state through the state at the index of the closed layer it was reached from.
+    std::vector<StateT> path;
+    auto reportTrace = [&](const StateT &goal, std::size_t layer, std::size_t index) {
+        path.assign(1, goal);
+        for (; index != packed_layers_t::no_parent; index = layers.parent(layer--, index)) {
+            path.emplace_back();
+            layers.state(layer, index, unpacked.data());
+            codec.decode(unpacked.data(), path.back());
+        }
+        ContainerT<StateT> trace;
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            trace.push_back(*it);
+        }
+        report(std::move(trace));
+    };
+
+    if (isGoalState(_initialState)) {
+        reportTrace(_initialState, 0, packed_layers_t::no_parent);
+    }
+    layers.add(encoded.data(), packed_layers_t::no_parent);
+    layers.close();
+
+    // The layer being expanded is unpacked one block at a time.
+    std::vector<char> block;
+    for (std::size_t layer = 0; layers.size(layer) > 0; ++layer) {
+        for (std::size_t i = 0; i < layers.size(layer); ++i) {
+            if (i % packed_layers_t::block_states == 0) {
+                layers.unpackBlock(layer, i / packed_layers_t::block_states, block);
+            }
+            codec.decode(block.data() + i % packed_layers_t::block_states * layers.width(), currentState);
+            auto transitions = _transitionFunction(currentState);
+            for (auto &transition: transitions) {
+                successor = currentState;
+                transition(successor);
+                if (!_invariantFunction(successor))
+                    continue;
+                if (isGoalState(successor)) {
+                    reportTrace(successor, layer, i);
+                }
+                encoded.clear();
+                codec.encode(successor, encoded);
+                if (encoded.size() != layers.width()) {
+                    throw std::length_error("sorted breadth-first search needs states packing to the same size");
+                }
+                layers.add(encoded.data(), static_cast<std::uint32_t>(i));
+            }
+        }
+        layers.close();
+    }
+}
+
+// Breadth-first search expanding the states of a round on several threads, see parallel_search_policy. A round takes
+// the waiting states in order, reporting goals and skipping passed states as the default solver does, and expands the
+// rest at once. Their successors are then interned in the order of the states they came from, which assigns the same
+// state ids and trace nodes as the default solver, so the traces are the same.
+template<class StateT, template<class...> class ContainerT, class CostT, class HashT>
+template<class ValidationF, class ReportF>
+void state_space_t<StateT, ContainerT, CostT, HashT>::parallelSolver(ValidationF isGoalState, std::size_t threads,
+                                                                     ReportF &report) {
+    reachability_detail::worker_pool_t workers(threads);
+    // The calling thread interns, so the tables are bound to the home node of the pool.
+    state_pool_t<StateT, HashT> states(HashT{}, workers.node(0));
+    trace_store_t traces(workers.node(0));
+    std::vector<bool> passed;
+    frontier_blocks_t waiting;
+    // The trace nodes expanded by a round, with where the successors of each are.
+    std::vector<trace_store_t::node_t> expanding;
+    auto scratch = workerScratch(workers);
+    std::vector<scratch_range_t> ranges;
+    std::vector<trace_store_t::node_t> blockParents;
+    std::vector<state_id_t> blockIds;
+    // The popped nodes of a round with their goal flag and whether they were expanded, kept for the search log.
+    struct popped_t {
+        trace_store_t::node_t node;
+        bool goal;
+        bool expanded;
+    };
+    std::vector<popped_t> popped;
+
+    waiting.push_back(traces.add(trace_store_t::no_parent, states.intern(_initialState).first));
+
+    while (!waiting.empty()) {
+        expanding.clear();
+        popped.clear();
+        for (std::size_t i = 0; i < parallel_expansions * threads && !waiting.empty(); ++i) {
+            auto traceState = waiting.front();
+            waiting.pop_front();
+            auto current = traces.state(traceState);
+            auto goal = isGoalState(states[current]);
+            if (goal) {
+                report(traces.trace<ContainerT>(traceState, states));
+            }
+            passed.resize(states.size());
+            auto expanded = !passed[current];
+            if (expanded) {
+                passed[current] = true;
+                expanding.push_back(traceState);
+            }
+            if (_log) {
+                popped.push_back(popped_t{traceState, goal, expanded});
+            }
+        }
+
+        for (auto &buffers: scratch) {
+            buffers.used = 0;
+        }
+        ranges.resize(expanding.size());
+        // The pool and trace store are only read while the round expands.
+        workers.run(expanding.size(), [&](std::size_t i, std::size_t worker) {
+            auto &buffers = scratch[worker];
+            auto count = expand(states[traces.state(expanding[i])], buffers.successors, buffers.used);
+            ranges[i] = scratch_range_t{worker, buffers.used, count};
+            resolve(states, buffers, ranges[i]);
+            buffers.used += count;
+        });
+        if (_log) {
+            std::size_t expansion = 0;
+            for (auto &entry: popped) {
+                _log->pop(entry.node, entry.goal);
+                if (entry.expanded) {
+                    _log->expansion(ranges[expansion++].count);
+                }
+            }
+        }
+
+        std::size_t generated = 0;
+        for (auto &range: ranges) {
+            generated += range.count;
+        }
+        blockParents.resize(std::max(blockParents.size(), generated));
+        blockIds.resize(std::max(blockIds.size(), generated));
+        auto size = states.size();
+        generated = 0;
+        for (std::size_t i = 0; i < expanding.size(); ++i) {
+            internRange(states, scratch[ranges[i].worker], ranges[i], blockIds.data() + generated);
+            std::fill_n(blockParents.begin() + generated, ranges[i].count, expanding[i]);
+            generated += ranges[i].count;
+        }
+        if (_log) {
+            _log->interned(blockIds, generated, size);
+        }
+        for (std::size_t i = 0; i < generated; ++i) {
+            waiting.push_back(traces.add(blockParents[i], blockIds[i]));
+        }
+    }
+    filtered(scratch);
+}
+
+// Breadth-first search as a pipeline of stages, see pipeline_search_policy. The calling thread pops the waiting states
+// into batches and passes them through the generation, filtering and hashing stages, then interns and records the
+// successors of the returning batches in the order it dispatched them. The states are popped, and their successors
+// interned, in the order of the default solver, which gives the same state ids, trace nodes and traces.
+template<class StateT, template<class...> class ContainerT, class CostT, class HashT>
+template<class ValidationF, class ReportF>
+void state_space_t<StateT, ContainerT, CostT, HashT>::pipelineSolver(ValidationF isGoalState, ReportF &report) {
+    using node_t = trace_store_t::node_t;
+    struct popped_t {
+        node_t node;
+        bool goal;
+        bool expanded;
+    };
+    // The stages reuse the states of a batch, so states owning memory keep their buffers between batches.
+    struct batch_t {
+        std::size_t sequence = 0;
+        std::vector<popped_t> popped;
+        std::vector<node_t> nodes;
+        std::vector<StateT> states;
+        std::vector<std::size_t> counts;
+        std::vector<StateT> successors;
+        std::size_t generated = 0;
+        std::vector<std::uint64_t> hashes;
+        std::exception_ptr error;
+    };
+    using batch_ptr = std::unique_ptr<batch_t>;
+    using queue_t = reachability_detail::batch_queue_t<batch_ptr>;
+
+    state_pool_t<StateT, HashT> states;
+    trace_store_t traces;
+    std::vector<bool> passed;
+    frontier_blocks_t waiting;
+    std::vector<state_id_t> ids;
+    auto filters = pipeline_search_policy::filters;
+    auto hashers = pipeline_search_policy::hashers;
+    auto batches = std::max<std::size_t>(1, pipeline_search_policy::batches);
+    auto batchStates = std::max<std::size_t>(1, pipeline_search_policy::batchStates);
+
+    auto generate = [this](batch_t &batch) {
+        batch.generated = 0;
+        batch.counts.assign(batch.nodes.size(), 0);
+        for (std::size_t i = 0; i < batch.nodes.size(); ++i) {
+            auto transitions = _transitionFunction(batch.states[i]);
+            for (auto &transition: transitions) {
+                if (batch.generated == batch.successors.size()) {
+                    batch.successors.push_back(batch.states[i]);
+                } else {
+                    batch.successors[batch.generated] = batch.states[i];
+                }
+                transition(batch.successors[batch.generated++]);
+                ++batch.counts[i];
+            }
+        }
+    };
+    // Moves the successors satisfying the invariant to the front, swapping keeps the buffers of the others.
+    auto filter = [this](batch_t &batch) {
+        std::size_t kept = 0, next = 0;
+        for (auto &count: batch.counts) {
+            auto last = next + count;
+            count = 0;
+            for (; next < last; ++next) {
+                if (_invariantFunction(batch.successors[next])) {
+                    if (kept != next) {
+                        std::swap(batch.successors[kept], batch.successors[next]);
+                    }
+                    ++kept;
+                    ++count;
+                }
+            }
+        }
+        batch.generated = kept;
+    };
+    auto hash = [&states](batch_t &batch) {
+        batch.hashes.resize(batch.generated);
+        for (std::size_t i = 0; i < batch.generated; ++i) {
+            batch.hashes[i] = states.hash(batch.successors[i]);
+        }
+    };
+    std::vector<std::pair<std::size_t, std::function<void(batch_t &)>>> stages;
+    stages.emplace_back(pipeline_search_policy::generators, [&](batch_t &batch) {
+        generate(batch);
+        if (!filters) {
+            filter(batch);
+            if (!hashers)
+                hash(batch);
+        }
+    });
+    if (filters) {
+        stages.emplace_back(filters, [&](batch_t &batch) {
+            filter(batch);
+            if (!hashers)
+                hash(batch);
+        });
+    }
+    if (hashers) {
+        stages.emplace_back(hashers, hash);
+    }
+
+    // Queue k feeds stage k and the last queue returns the batches, each closed by the threads of the stage before.
+    std::vector<std::unique_ptr<queue_t>> queues;
+    queues.push_back(std::make_unique<queue_t>(batches));
+    for (auto &stage: stages) {
+        queues.push_back(std::make_unique<queue_t>(batches, stage.first));
+    }
+    std::vector<std::thread> threads;
+    for (std::size_t k = 0; k < stages.size(); ++k) {
+        for (std::size_t thread = 0; thread < stages[k].first; ++thread) {
+            threads.emplace_back([&stages, &queues, k] {
+                batch_ptr batch;
+                while (queues[k]->pop(batch)) {
+                    if (!batch->error) {
+                        try {
+                            stages[k].second(*batch);
+                        } catch (...) {
+                            batch->error = std::current_exception();
+                        }
+                    }
+                    queues[k + 1]->push(std::move(batch));
+                }
+                queues[k + 1]->close();
+            });
+        }
+    }
+    auto &input = *queues.front();
+    auto &results = *queues.back();
+    auto stop = [&] {
+        input.close();
+        for (batch_ptr batch; results.pop(batch);) {
+        }
+        for (auto &thread: threads) {
+            thread.join();
+        }
+    };
+
+    // At most batches are in flight, so no queue fills up and the calling thread never waits on one but the last.
+    std::vector<batch_ptr> spare, returned(batches);
+    std::size_t dispatched = 0, recorded = 0;
+    try {
+        waiting.push_back(traces.add(trace_store_t::no_parent, states.intern(_initialState).first));
+        while (true) {
+            if (!waiting.empty() && dispatched - recorded < batches) {
+                batch_ptr batch;
+                if (spare.empty()) {
+                    batch = std::make_unique<batch_t>();
+                } else {
+                    batch = std::move(spare.back());
+                    spare.pop_back();
+                }
+                batch->popped.clear();
+                batch->nodes.clear();
+                while (batch->nodes.size() < batchStates && !waiting.empty()) {
+                    auto traceState = waiting.front();
+                    waiting.pop_front();
+                    auto current = traces.state(traceState);
+                    auto goal = isGoalState(states[current]);
+                    if (goal) {
+                        report(traces.trace<ContainerT>(traceState, states));
+                    }
+                    passed.resize(states.size());
+                    auto expanded = !passed[current];
+                    if (expanded) {
+                        passed[current] = true;
+                        if (batch->nodes.size() == batch->states.size()) {
+                            batch->states.push_back(states[current]);
+                        } else {
+                            batch->states[batch->nodes.size()] = states[current];
+                        }
+                        batch->nodes.push_back(traceState);
+                    }
+                    if (_log) {
+                        batch->popped.push_back(popped_t{traceState, goal, expanded});
+                    }
+                }
+                batch->sequence = dispatched++;
+                input.push(std::move(batch));
+                continue;
+            }
+            if (dispatched == recorded)
+                break;
 
-        _initialState = initialState;
-        _initialCost = initialCost;
-        _transitionFunction = transitionFunction;
-        _invariantFunction = invariantFunction;
-        _costFunction = costFunction;
-        _useCost = true;
+            batch_ptr batch;
+            results.pop(batch);
+            if (batch->error) {
+                std::rethrow_exception(batch->error);
+            }
+            auto sequence = batch->sequence;
+            returned[sequence % batches] = std::move(batch);
+            for (; recorded < dispatched && returned[recorded % batches]; ++recorded) {
+                auto &next = *returned[recorded % batches];
+                auto size = states.size();
+                states.internBatch(next.successors.data(), next.hashes.data(), next.generated, ids);
+                if (_log) {
+                    std::size_t expansion = 0;
+                    for (auto &entry: next.popped) {
+                        _log->pop(entry.node, entry.goal);
+                        if (entry.expanded) {
+                            _log->expansion(next.counts[expansion++]);
+                        }
+                    }
+                    _log->interned(ids, next.generated, size);
+                }
+                std::size_t successor = 0;
+                for (std::size_t i = 0; i < next.nodes.size(); ++i) {
+                    for (std::size_t j = 0; j < next.counts[i]; ++j) {
+                        waiting.push_back(traces.add(next.nodes[i], ids[successor++]));
+                    }
+                }
+                spare.push_back(std::move(returned[recorded % batches]));
+            }
+        }
+    } catch (...) {
+        stop();
+        throw;
     }
+    stop();
+}
 
-    // The function to call the solver, default search order is breadth_first, as a reasonable choice as defined in
-    // requirement 8.
-    template<class ValidationF>
-    ContainerT<ContainerT<StateT>> check(
-            ValidationF isGoalState,
-            search_order order = search_order::breadth_first) {
+// Cost search expanding the cheapest waiting states of a round on several threads, see parallel_search_policy. The
+// round is expanded ahead of time and committed in queue order as the default cost solver pops it. When a committed
+// state has a successor ordered before the next state of the round, the default solver would expand that successor
+// first, so the rest of the round goes back to the queue with the same costs and trace nodes and is taken again. The
+// order of the queue is total, so the traces are the same as those of the default cost solver.
+template<class StateT, template<class...> class ContainerT, class CostT, class HashT>
+template<class ValidationF, class ReportF>
+void state_space_t<StateT, ContainerT, CostT, HashT>::parallelCostSolver(ValidationF isGoalState, std::size_t threads,
+                                                                         ReportF &report) {
+    reachability_detail::worker_pool_t workers(threads);
+    // The calling thread interns, so the tables are bound to the home node of the pool.
+    state_pool_t<StateT, HashT> states(HashT{}, workers.node(0));
+    trace_store_t traces(workers.node(0));
+    std::vector<bool> passed;
+    using entry_t = std::pair<CostT, trace_store_t::node_t>;
+    std::priority_queue<entry_t, std::vector<entry_t>, reachability_detail::cost_order_t<entry_t>> waiting;
+    // The entries of a round, whether each expands its state, and where the successors with their costs are.
+    std::vector<entry_t> round;
+    std::vector<bool> expands;
+    auto scratch = workerScratch(workers);
+    std::vector<scratch_range_t> ranges;
+    std::vector<state_id_t> blockIds;
+
+    waiting.push(std::make_pair(_initialCost, traces.add(trace_store_t::no_parent, states.intern(_initialState).first)));
+
+    while (!waiting.empty()) {
+        // An entry expands its state if no earlier entry did, so the round marks the passed states as it is taken.
+        round.clear();
+        expands.clear();
+        passed.resize(states.size());
+        while (round.size() < expansion_block * threads && !waiting.empty()) {
+            round.push_back(waiting.top());
+            waiting.pop();
+            auto current = traces.state(round.back().second);
+            expands.push_back(!passed[current]);
+            passed[current] = true;
+        }
 
-        if (_useCost) {
-            return costSolver(isGoalState);
+        for (auto &buffers: scratch) {
+            buffers.used = 0;
+        }
+        ranges.resize(round.size());
+        workers.run(round.size(), [&](std::size_t i, std::size_t worker) {
+            auto &buffers = scratch[worker];
+            ranges[i] = scratch_range_t{worker, buffers.used, 0};
+            if (!expands[i])
+                return;
+            auto count = expand(states[traces.state(round[i].second)], buffers.successors, buffers.used);
+            buffers.costs.resize(std::max(buffers.costs.size(), buffers.used + count));
+            for (auto j = buffers.used; j < buffers.used + count; ++j) {
+                buffers.costs[j] = _costFunction(buffers.successors[j], round[i].first);
+            }
+            ranges[i].count = count;
+            resolve(states, buffers, ranges[i]);
+            buffers.used += count;
+        });
+
+        for (std::size_t i = 0; i < round.size(); ++i) {
+            auto traceState = round[i].second;
+            auto goal = isGoalState(states[traces.state(traceState)]);
+            if (goal) {
+                report(traces.trace<ContainerT>(traceState, states));
+            }
+            auto &buffers = scratch[ranges[i].worker];
+            auto offset = ranges[i].offset, count = ranges[i].count;
+            auto size = states.size();
+            blockIds.resize(std::max(blockIds.size(), count));
+            internRange(states, buffers, ranges[i], blockIds.data());
+            if (_log) {
+                _log->pop(traceState, goal);
+                if (expands[i]) {
+                    _log->expansion(count);
+                    _log->interned(blockIds, count, size);
+                }
+            }
+            for (std::size_t j = 0; j < count; ++j) {
+                waiting.push(std::make_pair(buffers.costs[offset + j], traces.add(traceState, blockIds[j])));
+            }
+            if (i + 1 < round.size() && !waiting.empty() &&
+                reachability_detail::cost_order_t<entry_t>{}(round[i + 1], waiting.top())) {
+                for (auto rest = i + 1; rest < round.size(); ++rest) {
+                    if (expands[rest])
+                        passed[traces.state(round[rest].second)] = false;
+                    waiting.push(round[rest]);
+                }
+                break;
+            }
         }
-        return solver(isGoalState, order);
     }
-};
+    filtered(scratch);
+}
 
-// The default solver when cost is not involved
-template<class StateT, template<class...> class ContainerT, class CostT>
-template<class ValidationF>
-ContainerT<ContainerT<StateT>>
-state_space_t<StateT, ContainerT, CostT>::solver(ValidationF isGoalState, search_order order) {
-    StateT currentState;
-    std::shared_ptr<trace_state<StateT>> traceState{};
-    std::list<StateT> passed;
-    std::list<std::shared_ptr<trace_state<StateT>>> waiting;
-    std::list<StateT> traces;
-
-    // Two containers are used, one to hold a result in the given container type and another to
-    // hold all solutions (result)
-    ContainerT<StateT> containedSolution;
-    ContainerT<ContainerT<StateT>> result;
+// Breadth-first or depth-first search over the shared graph, see shareGraph. Successors are taken in the order the
+// transitions generate them and trace nodes are added for them as the default solver adds them, so the search
+// explores the states in the same order and reports the same traces.
+template<class StateT, template<class...> class ContainerT, class CostT, class HashT>
+template<class ValidationF, class ReportF>
+void state_space_t<StateT, ContainerT, CostT, HashT>::sharedSolver(ValidationF isGoalState, search_order order,
+                                                                   ReportF &report) {
+    trace_store_t traces;
+    std::vector<bool> passed;
+    frontier_blocks_t waiting;
+    std::vector<StateT> successors;
+    std::vector<state_id_t> ids;
+    typename shared_graph_t<StateT, HashT>::filter_t filter;
 
-    // Add the initial to waiting list to have a starting point
-    // Set parent as nullptr to know when to stop
-    waiting.push_back(std::make_shared<trace_state<StateT>>(trace_state<StateT>{nullptr, _initialState}));
+    waiting.push_back(traces.add(trace_store_t::no_parent, _graph->intern(_initialState).first));
 
-    // Keep iterating through the waiting list until it is empty
     while (!waiting.empty()) {
-        // Requirement 4: Support various search orders (BFS, DFS)
+        trace_store_t::node_t traceState;
         if (order == search_order::breadth_first) {
-            currentState = waiting.front()->self;
             traceState = waiting.front();
             waiting.pop_front();
         } else if (order == search_order::depth_first) {
-            currentState = waiting.back()->self;
             traceState = waiting.back();
             waiting.pop_back();
         } else {
             std::cout << "Invalid search order supplied.";
+            return;
+        }
+        auto current = traces.state(traceState);
+        if (isGoalState((*_graph)[current])) {
+            report(traces.trace<ContainerT>(traceState, *_graph));
         }
 
-        // Requirement 2: Find a state satisfying the goal predicate
-        if (isGoalState(currentState)) {
-            while (traceState->parent != nullptr) {
-                // Add stack trace to the solution list
-                traces.push_front(traceState->self);
-                traceState = traceState->parent;
-            }
+        // Ids of the shared graph are spread over its shards, so passed grows to the highest id seen.
+        if (current >= passed.size()) {
+            passed.resize(current + 1);
+        }
+        if (passed[current]) {
+            continue;
+        }
+        passed[current] = true;
+        sharedSuccessors(current, successors, ids, filter);
+        for (auto id: ids) {
+            waiting.push_back(traces.add(traceState, id));
+        }
+    }
+    _graph->filtered(filter);
+}
 
-            // Add self trace to solution list
-            traces.push_front(traceState->self);
+// Cost search over the shared graph, see shareGraph. The costs depend on the path and are computed by every search.
+template<class StateT, template<class...> class ContainerT, class CostT, class HashT>
+template<class ValidationF, class ReportF>
+void state_space_t<StateT, ContainerT, CostT, HashT>::sharedCostSolver(ValidationF isGoalState, ReportF &report) {
+    trace_store_t traces;
+    std::vector<bool> passed;
+    std::vector<StateT> successors;
+    std::vector<state_id_t> ids;
+    typename shared_graph_t<StateT, HashT>::filter_t filter;
+    using entry_t = std::pair<CostT, trace_store_t::node_t>;
+    std::priority_queue<entry_t, std::vector<entry_t>, reachability_detail::cost_order_t<entry_t>> waiting;
 
-            // Convert to a generic type by pushing them all to the contained solution.
-            for (auto &trace: traces) {
-                containedSolution.push_back(trace);
-            }
+    waiting.push(std::make_pair(_initialCost, traces.add(trace_store_t::no_parent,
+                                                         _graph->intern(_initialState).first)));
 
-            // Requirement 3: containedSolution now holds a state sequence from initial to a goal state.
-            // Add found result to list of result traces.
-            result.push_back(containedSolution);
+    while (!waiting.empty()) {
+        auto currentCost = waiting.top().first;
+        auto traceState = waiting.top().second;
+        waiting.pop();
+        auto current = traces.state(traceState);
+        if (isGoalState((*_graph)[current])) {
+            report(traces.trace<ContainerT>(traceState, *_graph));
         }
 
-        // Check if the element already exists between in the passed states list to ensure that
-        // you don't re-visit it.
-        if (!(find(passed.begin(), passed.end(), currentState) != passed.end())) {
-            passed.push_back(currentState);
-            auto transitions = _transitionFunction(currentState);
+        if (current >= passed.size()) {
+            passed.resize(current + 1);
+        }
+        if (passed[current]) {
+            continue;
+        }
+        passed[current] = true;
+        sharedSuccessors(current, successors, ids, filter);
+        for (auto id: ids) {
+            waiting.push(std::make_pair(_costFunction((*_graph)[id], currentCost), traces.add(traceState, id)));
+        }
+    }
+    _graph->filtered(filter);
+}
 
-            for (auto transition: transitions) {
-                auto successor{currentState};
-                transition(successor);
+// Replays a search log. The trace store is rebuilt as the search built it: an expansion generates the successors of
+// the last popped node, and the first interned state after expansions interns all their successors together, as the
+// solvers intern a block.
+template<class StateT, template<class...> class ContainerT, class CostT, class HashT>
+template<class ValidationF>
+search_replay_t state_space_t<StateT, ContainerT, CostT, HashT>::replay(ValidationF isGoalState,
+                                                                         const search_log_t &log) {
+    state_pool_t<StateT, HashT> states;
+    trace_store_t traces;
+    // The costs of the trace nodes, so the cost function is called as by the cost search.
+    std::vector<CostT> costs;
+    std::vector<StateT> successors, pending;
+    std::vector<CostT> successorCosts, pendingCosts;
+    std::vector<trace_store_t::node_t> parents;
+    std::vector<state_id_t> ids;
+    std::size_t interned = 0;
+    auto node = trace_store_t::no_parent;
+    search_replay_t result;
+    // The cost search prunes the successors of an expansion, which are logged before pruning.
+    auto pruned = _useCost && _dominanceKey;
+    dominance_index_t dominance;
 
-                // Requirement 5: Support a given invariant predicate.
-                if (_invariantFunction(successor)) {
-                    waiting.push_back(std::make_shared<trace_state<StateT>>(trace_state<StateT>{traceState, successor}));
+    traces.add(trace_store_t::no_parent, states.intern(_initialState).first);
+    costs.push_back(_initialCost);
+    if (pruned) {
+        dominance.insert(_dominanceKey(_initialState), _dominanceFields(_initialState, _initialCost));
+    }
+
+    auto diverge = [&result](const search_log_t::event_t &event, std::string found) {
+        result.divergence = result.events;
+        result.expected = search_log_t::describe(event);
+        result.found = std::move(found);
+        return false;
+    };
+    log.events([&](const search_log_t::event_t &event) {
+        switch (event.kind) {
+            case search_log_t::kind::pop: {
+                if (interned < ids.size())
+                    return diverge(event, std::to_string(ids.size() - interned) + " more interned states");
+                if (event.value >= traces.size())
+                    return diverge(event, std::to_string(traces.size()) + " trace nodes");
+                node = static_cast<trace_store_t::node_t>(event.value);
+                auto goal = isGoalState(states[traces.state(node)]);
+                if (goal != event.flag)
+                    return diverge(event, goal ? "a goal" : "no goal");
+                result.goals += goal;
+                break;
+            }
+            case search_log_t::kind::expansion: {
+                if (node == trace_store_t::no_parent)
+                    return diverge(event, "no popped node to expand");
+                auto count = expand(states[traces.state(node)], successors);
+                if (count != event.value)
+                    return diverge(event, "expansion into " + std::to_string(count) + " successors");
+                successorCosts.resize(std::max(successorCosts.size(), count));
+                for (std::size_t i = 0; i < count; ++i) {
+                    successorCosts[i] = _useCost ? _costFunction(successors[i], costs[node]) : CostT{};
                 }
+                if (pruned)
+                    count = prune(dominance, successors, successorCosts, count);
+                for (std::size_t i = 0; i < count; ++i) {
+                    pending.push_back(successors[i]);
+                    parents.push_back(node);
+                    pendingCosts.push_back(successorCosts[i]);
+                }
+                node = trace_store_t::no_parent;
+                break;
+            }
+            case search_log_t::kind::state: {
+                if (interned == ids.size()) {
+                    if (pending.empty())
+                        return diverge(event, "no successors to intern");
+                    states.internBatch(pending.data(), pending.size(), ids);
+                    for (std::size_t i = 0; i < ids.size(); ++i) {
+                        traces.add(parents[i], ids[i]);
+                        costs.push_back(pendingCosts[i]);
+                    }
+                    pending.clear();
+                    parents.clear();
+                    pendingCosts.clear();
+                    interned = 0;
+                }
+                if (ids[interned] != event.value)
+                    return diverge(event, "state " + std::to_string(ids[interned]));
+                ++interned;
+                break;
             }
         }
+        ++result.events;
+        return true;
+    });
+    if (result.divergence == search_log_t::no_event && (interned < ids.size() || !pending.empty())) {
+        result.divergence = result.events;
+        result.expected = "end of the search";
+        result.found = std::to_string(ids.size() - interned + pending.size()) + " more interned states";
     }
     return result;
 }
 
-// Requirement 6: Support a custom cost function over states.
-// This cost solver uses the cost rather than DFS or BFS for traversing the waiting list.
-template<class StateT, template<class...> class ContainerT, class CostT>
+#ifdef __linux__
+// Breadth-first search distributed over a cluster. Every round expands the layer of waiting states each process owns
+// and sends the successors to their owners, which intern them and queue them for the next round. The search ends
+// after a round in which no process had waiting states.
+template<class StateT, template<class...> class ContainerT, class CostT, class HashT>
 template<class ValidationF>
 ContainerT<ContainerT<StateT>>
-state_space_t<StateT, ContainerT, CostT>::costSolver(ValidationF isGoalState) {
+state_space_t<StateT, ContainerT, CostT, HashT>::distributedSolver(ValidationF isGoalState, cluster_t &cluster) {
+    using node_t = distributed_trace_store_t::node_t;
+    using parent_t = distributed_trace_store_t::parent_t;
+    auto rank = static_cast<std::uint32_t>(cluster.rank());
+    state_codec<StateT> codec;
     StateT currentState;
-    CostT currentCost, newCost;
-    currentCost = _initialCost;
-    std::shared_ptr<trace_state<StateT>> traceState;
-    std::list<StateT> passed, solution;
-    std::priority_queue<std::pair<CostT, std::shared_ptr<trace_state<StateT>>>> waiting;
-    ContainerT<StateT> containedSolution;
-    ContainerT<ContainerT<StateT>> result;
+    state_pool_t<StateT, HashT> states;
+    distributed_trace_store_t traces;
+    std::vector<bool> passed;
+    std::vector<node_t> waiting, next;
+    std::vector<distributed_goal_t> goals;
+    // Successors owned by this process and successors received from others are interned in blocks.
+    std::vector<StateT> block, inbound;
+    std::vector<parent_t> blockParents, inboundParents;
+    std::vector<state_id_t> blockIds;
+    // Successors owned by others are collected per process as records of the parent node and the encoded state.
+    std::vector<std::vector<char>> outboxes(cluster.size());
+    std::vector<char> encoded;
 
-    // Generate a set of cost and trace state to find the lowest cost aka where to go next
-    waiting.push(std::make_pair(currentCost, std::make_shared<trace_state<StateT>>(trace_state<StateT>{nullptr, _initialState})));
+    auto enqueue = [&](std::vector<StateT> &successors, std::vector<parent_t> &parents, std::size_t count) {
+        states.internBatch(successors.data(), count, blockIds);
+        for (std::size_t i = 0; i < count; ++i) {
+            next.push_back(traces.add(parents[i], blockIds[i]));
+        }
+    };
+    auto receive = [&](std::size_t peer, cluster_t::frame, const char *data, std::size_t size) {
+        std::size_t count = 0;
+        for (auto end = data + size; data != end; ++count) {
+            if (count == inbound.size()) {
+                inbound.emplace_back();
+                inboundParents.emplace_back();
+            }
+            inboundParents[count].rank = static_cast<std::uint32_t>(peer);
+            data = codec.decode(reachability_detail::get(data, inboundParents[count].node), inbound[count]);
+        }
+        enqueue(inbound, inboundParents, count);
+    };
+    auto send = [&](std::size_t minimum) {
+        for (std::size_t peer = 0; peer < outboxes.size(); ++peer) {
+            if (!outboxes[peer].empty() && outboxes[peer].size() >= minimum) {
+                cluster.post(peer, cluster_t::frame::states, outboxes[peer], receive);
+                outboxes[peer].clear();
+            }
+        }
+    };
 
-    while (!waiting.empty()) {
-        // Prepare to go to the next state, which is next in the queue
-        currentState = waiting.top().second->self;
-        currentCost = waiting.top().first; // First element of pair is cost
-        traceState = waiting.top().second; // Second element is trace state
-        waiting.pop();
+    codec.encode(_initialState, encoded);
+    if (cluster.owner(encoded) == rank) {
+        auto initial = states.intern(_initialState).first;
+        waiting.push_back(traces.add(parent_t{distributed_trace_store_t::no_rank, trace_store_t::no_parent}, initial));
+    }
+
+    for (std::uint32_t round = 0;; ++round) {
+        for (std::size_t first = 0; first < waiting.size(); first += expansion_block) {
+            std::size_t generated = 0;
+            auto last = std::min(waiting.size(), first + expansion_block);
+            for (auto i = first; i < last; ++i) {
+                auto node = waiting[i];
+                auto current = traces.state(node);
+                currentState = states[current];
+
+                if (isGoalState(currentState)) {
+                    goals.push_back(distributed_goal_t{node, round});
+                }
+
+                passed.resize(states.size());
+                if (passed[current])
+                    continue;
+                passed[current] = true;
+                auto transitions = _transitionFunction(currentState);
+
+                for (auto &transition: transitions) {
+                    if (generated == block.size()) {
+                        block.push_back(currentState);
+                        blockParents.emplace_back();
+                    } else {
+                        block[generated] = currentState;
+                    }
+                    transition(block[generated]);
+                    if (!_invariantFunction(block[generated]))
+                        continue;
 
-        if (isGoalState(currentState)) {
-            while (traceState->parent != nullptr) {
-                // Add stack trace to the solution list
-                solution.push_front(traceState->self);
-                traceState = traceState->parent;
+                    encoded.clear();
+                    codec.encode(block[generated], encoded);
+                    auto owner = cluster.owner(encoded);
+                    if (owner == rank) {
+                        blockParents[generated++] = parent_t{rank, node};
+                    } else {
+                        reachability_detail::put(outboxes[owner], node);
+                        outboxes[owner].insert(outboxes[owner].end(), encoded.begin(), encoded.end());
+                    }
+                }
             }
+            enqueue(block, blockParents, generated);
+            send(cluster_t::batch_bytes);
+            cluster.pump(receive);
+        }
+        send(0);
+
+        std::vector<char> marker;
+        reachability_detail::put(marker, static_cast<std::uint64_t>(waiting.size()));
+        std::uint64_t expanded = 0;
+        for (auto &peerMarker: cluster.endRound(marker, receive)) {
+            std::uint64_t count;
+            reachability_detail::get(peerMarker.data(), count);
+            expanded += count;
+        }
+        waiting.swap(next);
+        next.clear();
+        if (expanded == 0)
+            break;
+    }
 
-            // Add self trace to solution list
-            solution.push_front(traceState->self);
+    return distributedTraces(cluster, states, traces, goals);
+}
 
+// Cost search distributed over a cluster. The processes agree on the cheapest waiting cost among them, then each
+// expands all its waiting states of that cost and sends the successors to their owners, round after round until no
+// process has waiting states. Within a process ties are broken as in the cost solver.
+template<class StateT, template<class...> class ContainerT, class CostT, class HashT>
+template<class ValidationF>
+ContainerT<ContainerT<StateT>>
+state_space_t<StateT, ContainerT, CostT, HashT>::distributedCostSolver(ValidationF isGoalState, cluster_t &cluster) {
+    using node_t = distributed_trace_store_t::node_t;
+    using parent_t = distributed_trace_store_t::parent_t;
+    auto rank = static_cast<std::uint32_t>(cluster.rank());
+    state_codec<StateT> codec;
+    state_codec<CostT> costCodec;
+    StateT currentState;
+    CostT currentCost;
+    state_pool_t<StateT, HashT> states;
+    distributed_trace_store_t traces;
+    std::vector<bool> passed;
+    std::vector<distributed_goal_t> goals;
+    std::vector<StateT> block, inbound;
+    std::vector<CostT> blockCosts, inboundCosts;
+    std::vector<parent_t> blockParents, inboundParents;
+    std::vector<state_id_t> blockIds;
+    // Records of the parent node, the encoded cost and the encoded state.
+    std::vector<std::vector<char>> outboxes(cluster.size());
+    std::vector<char> encoded;
+    using entry_t = std::pair<CostT, node_t>;
+    std::priority_queue<entry_t, std::vector<entry_t>, reachability_detail::cost_order_t<entry_t>> waiting;
 
-            // Convert to a container
-            for (StateT &st: solution) {
-                containedSolution.push_back(st);
+    auto enqueue = [&](std::vector<StateT> &successors, std::vector<CostT> &costs, std::vector<parent_t> &parents,
+                       std::size_t count) {
+        states.internBatch(successors.data(), count, blockIds);
+        for (std::size_t i = 0; i < count; ++i) {
+            waiting.push(std::make_pair(costs[i], traces.add(parents[i], blockIds[i])));
+        }
+    };
+    auto receive = [&](std::size_t peer, cluster_t::frame, const char *data, std::size_t size) {
+        std::size_t count = 0;
+        for (auto end = data + size; data != end; ++count) {
+            if (count == inbound.size()) {
+                inbound.emplace_back();
+                inboundCosts.emplace_back();
+                inboundParents.emplace_back();
+            }
+            inboundParents[count].rank = static_cast<std::uint32_t>(peer);
+            data = reachability_detail::get(data, inboundParents[count].node);
+            data = codec.decode(costCodec.decode(data, inboundCosts[count]), inbound[count]);
+        }
+        enqueue(inbound, inboundCosts, inboundParents, count);
+    };
+    auto send = [&](std::size_t minimum) {
+        for (std::size_t peer = 0; peer < outboxes.size(); ++peer) {
+            if (!outboxes[peer].empty() && outboxes[peer].size() >= minimum) {
+                cluster.post(peer, cluster_t::frame::states, outboxes[peer], receive);
+                outboxes[peer].clear();
             }
+        }
+    };
 
-            result.push_back(containedSolution);
+    codec.encode(_initialState, encoded);
+    if (cluster.owner(encoded) == rank) {
+        auto initial = states.intern(_initialState).first;
+        waiting.push(std::make_pair(_initialCost, traces.add(
+                parent_t{distributed_trace_store_t::no_rank, trace_store_t::no_parent}, initial)));
+    }
+
+    for (std::uint32_t round = 0;; ++round) {
+        // Agree on the cheapest waiting cost, the markers hold whether a process waits and its cheapest cost.
+        std::vector<char> marker;
+        reachability_detail::put(marker, static_cast<std::uint8_t>(!waiting.empty()));
+        if (!waiting.empty()) {
+            costCodec.encode(waiting.top().first, marker);
+        }
+        auto found = false;
+        CostT cheapest;
+        for (auto &peerMarker: cluster.endRound(marker, receive)) {
+            std::uint8_t waits;
+            auto data = reachability_detail::get(peerMarker.data(), waits);
+            if (!waits)
+                continue;
+            CostT cost;
+            costCodec.decode(data, cost);
+            if (!found || cheapest < cost) {
+                cheapest = cost;
+                found = true;
+            }
         }
+        if (!found)
+            break;
 
-        // Check if current state has already been passed otherwise push it
-        if (!(find(passed.begin(), passed.end(), currentState) != passed.end())) {
-            passed.push_back(currentState);
-            auto transitions = _transitionFunction(currentState);
+        std::size_t expanded = 0;
+        while (!waiting.empty() && !(waiting.top().first < cheapest)) {
+            currentCost = waiting.top().first;
+            auto node = waiting.top().second;
+            waiting.pop();
+            auto current = traces.state(node);
+            currentState = states[current];
 
-            for (auto transition: transitions) {
-                auto successor{currentState};
-                transition(successor);
+            if (isGoalState(currentState)) {
+                goals.push_back(distributed_goal_t{node, round});
+            }
+
+            passed.resize(states.size());
+            if (passed[current])
+                continue;
+            passed[current] = true;
+            auto transitions = _transitionFunction(currentState);
 
-                if (!_invariantFunction(successor)) {
+            std::size_t generated = 0;
+            for (auto &transition: transitions) {
+                if (generated == block.size()) {
+                    block.push_back(currentState);
+                    blockCosts.emplace_back();
+                    blockParents.emplace_back();
+                } else {
+                    block[generated] = currentState;
+                }
+                transition(block[generated]);
+                if (!_invariantFunction(block[generated]))
                     continue;
+
+                blockCosts[generated] = _costFunction(block[generated], currentCost);
+                encoded.clear();
+                codec.encode(block[generated], encoded);
+                auto owner = cluster.owner(encoded);
+                if (owner == rank) {
+                    blockParents[generated++] = parent_t{rank, node};
+                } else {
+                    reachability_detail::put(outboxes[owner], node);
+                    costCodec.encode(blockCosts[generated], outboxes[owner]);
+                    outboxes[owner].insert(outboxes[owner].end(), encoded.begin(), encoded.end());
+                }
+            }
+            enqueue(block, blockCosts, blockParents, generated);
+
+            if (++expanded % expansion_block == 0) {
+                send(cluster_t::batch_bytes);
+                cluster.pump(receive);
+            }
+        }
+        // Deliver all successors of this round before agreeing on the next cost.
+        send(0);
+        cluster.endRound({}, receive);
+    }
+
+    return distributedTraces(cluster, states, traces, goals);
+}
+
+// Reconstructs the traces of a distributed search on rank 0. A trace is walked from its goal towards the initial
+// state: each process follows the parents it owns, sends the states it passes to rank 0 and hands the walk over to
+// the owner of the next parent for the following round, until no walks are left.
+template<class StateT, template<class...> class ContainerT, class CostT, class HashT>
+ContainerT<ContainerT<StateT>>
+state_space_t<StateT, ContainerT, CostT, HashT>::distributedTraces(cluster_t &cluster,
+                                                                  const state_pool_t<StateT, HashT> &states,
+                                                                  const distributed_trace_store_t &traces,
+                                                                  const std::vector<distributed_goal_t> &goals) {
+    using node_t = distributed_trace_store_t::node_t;
+    auto rank = static_cast<std::uint32_t>(cluster.rank());
+    state_codec<StateT> codec;
+
+    // A walk of the trace of a goal, identified by the rank and index of the goal, at the given steps from it.
+    struct walk_t {
+        std::uint32_t origin;
+        std::uint32_t index;
+        std::uint32_t steps;
+        node_t node;
+    };
+    struct gathered_t {
+        std::uint32_t round = 0;
+        std::vector<StateT> states;
+    };
+    std::vector<walk_t> walks, arrived;
+    std::map<std::pair<std::uint32_t, std::uint32_t>, gathered_t> gathered;
+    std::vector<std::vector<char>> walkOutboxes(cluster.size());
+    std::vector<char> goalOutbox, stateOutbox;
+    StateT received;
+
+    auto gather = [&](const walk_t &walk, const StateT &state) {
+        auto &trace = gathered[{walk.origin, walk.index}].states;
+        if (trace.size() <= walk.steps) {
+            trace.resize(walk.steps + 1);
+        }
+        trace[walk.steps] = state;
+    };
+    auto receive = [&](std::size_t, cluster_t::frame kind, const char *data, std::size_t size) {
+        for (auto end = data + size; data != end;) {
+            walk_t walk;
+            data = reachability_detail::get(data, walk);
+            if (kind == cluster_t::frame::trace_goals) {
+                gathered[{walk.origin, walk.index}].round = walk.steps;
+            } else if (kind == cluster_t::frame::trace_walks) {
+                arrived.push_back(walk);
+            } else {
+                data = codec.decode(data, received);
+                gather(walk, received);
+            }
+        }
+    };
+
+    // The goals are announced to rank 0 with their round in place of the steps.
+    for (std::uint32_t index = 0; index < goals.size(); ++index) {
+        auto goal = walk_t{rank, index, goals[index].round, goals[index].node};
+        if (rank == 0) {
+            gathered[{rank, index}].round = goal.steps;
+        } else {
+            reachability_detail::put(goalOutbox, goal);
+        }
+        walks.push_back(walk_t{rank, index, 0, goals[index].node});
+    }
+    if (!goalOutbox.empty()) {
+        cluster.post(0, cluster_t::frame::trace_goals, goalOutbox, receive);
+    }
+
+    for (;;) {
+        for (auto walk: walks) {
+            for (;;) {
+                auto &state = states[traces.state(walk.node)];
+                if (rank == 0) {
+                    gather(walk, state);
+                } else {
+                    reachability_detail::put(stateOutbox, walk);
+                    codec.encode(state, stateOutbox);
+                    if (stateOutbox.size() >= cluster_t::batch_bytes) {
+                        cluster.post(0, cluster_t::frame::trace_states, stateOutbox, receive);
+                        stateOutbox.clear();
+                    }
                 }
-                newCost = _costFunction(successor, currentCost);
-                waiting.push(std::make_pair(newCost, std::make_shared<trace_state<StateT>>(trace_state<StateT>{traceState, successor})));
+                auto parent = traces.parent(walk.node);
+                if (parent.rank == distributed_trace_store_t::no_rank)
+                    break;
+                ++walk.steps;
+                walk.node = parent.node;
+                if (parent.rank != rank) {
+                    reachability_detail::put(walkOutboxes[parent.rank], walk);
+                    break;
+                }
+            }
+        }
+        for (std::size_t peer = 0; peer < walkOutboxes.size(); ++peer) {
+            if (!walkOutboxes[peer].empty()) {
+                cluster.post(peer, cluster_t::frame::trace_walks, walkOutboxes[peer], receive);
+                walkOutboxes[peer].clear();
             }
         }
+        if (!stateOutbox.empty()) {
+            cluster.post(0, cluster_t::frame::trace_states, stateOutbox, receive);
+            stateOutbox.clear();
+        }
+
+        std::vector<char> marker;
+        reachability_detail::put(marker, static_cast<std::uint64_t>(walks.size()));
+        std::uint64_t walked = 0;
+        for (auto &peerMarker: cluster.endRound(marker, receive)) {
+            std::uint64_t count;
+            reachability_detail::get(peerMarker.data(), count);
+            walked += count;
+        }
+        walks.swap(arrived);
+        arrived.clear();
+        if (walked == 0)
+            break;
     }
 
+    // Report the traces in the order their goals were reached, the states were gathered from the goal backwards.
+    std::vector<std::pair<std::pair<std::uint32_t, std::pair<std::uint32_t, std::uint32_t>>, gathered_t *>> ordered;
+    for (auto &trace: gathered) {
+        ordered.emplace_back(std::make_pair(trace.second.round, trace.first), &trace.second);
+    }
+    std::sort(ordered.begin(), ordered.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+    ContainerT<ContainerT<StateT>> result;
+    for (auto &trace: ordered) {
+        ContainerT<StateT> path;
+        for (auto it = trace.second->states.rbegin(); it != trace.second->states.rend(); ++it) {
+            path.push_back(*it);
+        }
+        result.push_back(std::move(path));
+    }
     return result;
 }
+#endif
+
+// Declarative river crossing puzzles: actors cross between two shores in a boat of some capacity, some of them row
+// and some must not be left together. river_rules_t declares the puzzle and compiles it into a river_model_t, whose
+// state is a few bitmasks, whose moves come from a table of masks and whose invariant looks the actors at each place
+// up in a table of the allowed groups, instead of hand-written transitions comparing the actors one by one.
+
+// The place of an actor, or of the boat, where boat means the boat is crossing.
+enum class river_place : std::uint32_t {
+    shore1, boat, shore2
+};
+
+// When a forbidden group is checked: always, or only while the boat crosses, as boarding and leaving the boat are
+// steps of a crossing during which a shore may hold the group for a moment.
+enum class river_check {
+    always, crossing
+};
+
+// A state of a compiled river crossing. The actors in neither mask wait on the first shore.
+struct river_state_t {
+    std::uint32_t onboard = 0;
+    std::uint32_t across = 0;
+    river_place boat = river_place::shore1;
+};
+
+inline bool operator==(const river_state_t &a, const river_state_t &b) {
+    return a.onboard == b.onboard && a.across == b.across && a.boat == b.boat;
+}
+
+template<>
+struct state_hash<river_state_t> : packed_hash<river_state_t> {
+};
+
+class river_rules_t;
+
+// A river crossing compiled by river_rules_t, copies share the tables.
+class river_model_t {
+public:
+    using actor_t = std::size_t;
+
+    // Every actor on the first shore with the boat.
+    river_state_t initial() const {
+        return river_state_t{};
+    }
+
+    // Whether every actor is across.
+    bool crossed(const river_state_t &state) const {
+        return state.across == _tables->all;
+    }
+
+    river_place place(const river_state_t &state, actor_t actor) const {
+        auto bit = std::uint32_t{1} << actor;
+        return state.onboard & bit ? river_place::boat : state.across & bit ? river_place::shore2 : river_place::shore1;
+    }
+
+    std::size_t passengers(const river_state_t &state) const {
+        return count(state.onboard);
+    }
+
+    std::size_t actors() const {
+        return _tables->names.size();
+    }
+
+    const std::string &name(actor_t actor) const {
+        return _tables->names[actor];
+    }
+
+    // The moves enabled in a state in the order of the move table: the boat departs or arrives at either shore, then
+    // each actor boards or leaves the boat at its shore.
+    transitions_t<river_state_t> transitions(const river_state_t &state) const {
+        transitions_t<river_state_t> result;
+        auto &tables = *_tables;
+        for (auto &move: tables.moves) {
+            if (enabled(tables, move, state))
+                result.emplace_back([move](river_state_t &s) { apply(move, s); });
+        }
+        return result;
+    }
+
+    // Whether a state keeps the rules: a crossing boat is rowed and the actors at each place form an allowed group.
+    bool valid(const river_state_t &state) const {
+        auto &tables = *_tables;
+        if (passengers(state) > tables.capacity)
+            return false;
+        auto check = allowed_always;
+        if (state.boat == river_place::boat) {
+            if (!(state.onboard & tables.rowers))
+                return false;
+            check = allowed_crossing;
+        }
+        auto waiting = tables.all & ~state.onboard & ~state.across;
+        return (allowed(tables, waiting) & check) && (allowed(tables, state.onboard) & check) &&
+               (allowed(tables, state.across) & check);
+    }
+
+    // The generator and invariant of the model for state_space_t, they hold a copy of the model.
+    template<template<class...> class ContainerT = std::vector>
+    successor_generator_t<river_state_t, ContainerT> successors() const {
+        return {[model = *this](river_state_t &state) { return model.transitions(state); }};
+    }
+
+    std::function<bool(const river_state_t &)> invariant() const {
+        return [model = *this](const river_state_t &state) { return model.valid(state); };
+    }
+
+private:
+    friend class river_rules_t;
+
+    // Groups are looked up in a table up to this many actors, larger puzzles check the forbidden groups one by one.
+    static constexpr std::size_t table_actors = 16;
+    static constexpr std::uint8_t allowed_always = 1;
+    static constexpr std::uint8_t allowed_crossing = 2;
+
+    enum class move_kind : std::uint32_t {
+        depart, arrive1, arrive2, board, leave
+    };
+
+    struct move_t {
+        move_kind kind;
+        std::uint32_t actor;
+    };
+
+    struct forbidden_t {
+        std::uint32_t actors;
+        std::uint32_t others;
+        std::uint32_t guards;
+        river_check when;
+    };
+
+    struct tables_t {
+        std::vector<std::string> names;
+        std::size_t capacity = 0;
+        std::uint32_t all = 0;
+        std::uint32_t rowers = 0;
+        std::vector<forbidden_t> forbidden;
+        std::vector<move_t> moves;
+        // The allowed_always and allowed_crossing bits of every group of actors, empty above table_actors.
+        std::vector<std::uint8_t> groups;
+    };
+
+    std::shared_ptr<const tables_t> _tables;
+
+    explicit river_model_t(std::shared_ptr<const tables_t> tables) : _tables(std::move(tables)) {}
+
+    static std::size_t count(std::uint32_t actors) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<std::size_t>(__builtin_popcount(actors));
+#else
+        std::size_t result = 0;
+        for (; actors; actors &= actors - 1) {
+            ++result;
+        }
+        return result;
+#endif
+    }
+
+    // The allowed bits of a group of actors at one place.
+    static std::uint8_t group(const std::vector<forbidden_t> &forbidden, std::uint32_t actors) {
+        std::uint8_t result = allowed_always | allowed_crossing;
+        for (auto &rule: forbidden) {
+            if ((actors & rule.actors) && (actors & rule.others) && !(actors & rule.guards)) {
+                result &= rule.when == river_check::always ? 0 : allowed_always;
+            }
+        }
+        return result;
+    }
+
+    static std::uint8_t allowed(const tables_t &tables, std::uint32_t actors) {
+        return tables.groups.empty() ? group(tables.forbidden, actors) : tables.groups[actors];
+    }
+
+    static bool enabled(const tables_t &tables, const move_t &move, const river_state_t &state) {
+        switch (move.kind) {
+            case move_kind::depart:
+                return state.boat != river_place::boat && state.onboard;
+            case move_kind::arrive1:
+            case move_kind::arrive2:
+                return state.boat == river_place::boat;
+            case move_kind::board: {
+                if (state.boat == river_place::boat || count(state.onboard) >= tables.capacity)
+                    return false;
+                auto across = (state.across & move.actor) != 0;
+                return !(state.onboard & move.actor) && across == (state.boat == river_place::shore2);
+            }
+            case move_kind::leave:
+                return state.boat != river_place::boat && (state.onboard & move.actor);
+        }
+        return false;
+    }
+
+    static void apply(const move_t &move, river_state_t &state) {
+        switch (move.kind) {
+            case move_kind::depart:
+                state.boat = river_place::boat;
+                break;
+            case move_kind::arrive1:
+                state.boat = river_place::shore1;
+                state.onboard = 0;
+                break;
+            case move_kind::arrive2:
+                state.boat = river_place::shore2;
+                state.across |= state.onboard;
+                state.onboard = 0;
+                break;
+            case move_kind::board:
+                state.across &= ~move.actor;
+                state.onboard |= move.actor;
+                break;
+            case move_kind::leave:
+                state.onboard &= ~move.actor;
+                if (state.boat == river_place::shore2)
+                    state.across |= move.actor;
+                break;
+        }
+    }
+};
+
+// Declares a river crossing puzzle, for example a farmer rowing a wolf, a goat and a cabbage across:
+//     auto rules = river_rules_t{2};
+//     auto farmer = rules.actor("farmer"), wolf = rules.actor("wolf"), goat = rules.actor("goat"),
+//          cabbage = rules.actor("cabbage");
+//     rules.rowers({farmer}).forbid({goat}, {wolf, cabbage}, {farmer});
+//     auto model = rules.compile();
+//     auto space = state_space_t{model.initial(), model.successors(), model.invariant()};
+//     auto traces = space.check([&model](const river_state_t &state) { return model.crossed(state); });
+class river_rules_t {
+public:
+    using actor_t = river_model_t::actor_t;
+    // A state holds the actors in 32-bit masks.
+    static constexpr std::size_t max_actors = 32;
+
+    explicit river_rules_t(std::size_t capacity) : _capacity(capacity) {}
+
+    // Adds an actor waiting on the first shore and returns its index for the rules.
+    actor_t actor(std::string name) {
+        if (_names.size() == max_actors)
+            throw std::length_error("river rules exceed " + std::to_string(max_actors) + " actors");
+        _names.push_back(std::move(name));
+        return _names.size() - 1;
+    }
+
+    // The actors able to row, a crossing boat needs one of them on board.
+    river_rules_t &rowers(std::initializer_list<actor_t> actors) {
+        _rowers |= mask(actors);
+        return *this;
+    }
+
+    // Forbids any of actors to be at a place, a shore or the boat, with any of others unless one of guards is there.
+    river_rules_t &forbid(std::initializer_list<actor_t> actors, std::initializer_list<actor_t> others,
+                          std::initializer_list<actor_t> guards = {}, river_check when = river_check::always) {
+        _forbidden.push_back(river_model_t::forbidden_t{mask(actors), mask(others), mask(guards), when});
+        return *this;
+    }
+
+    // Builds the move table and, for up to 16 actors, the table of the allowed groups of every place.
+    river_model_t compile() const {
+        if (_capacity == 0 || _rowers == 0)
+            throw std::invalid_argument("river rules need a boat capacity and a rower");
+        using move_t = river_model_t::move_t;
+        using move_kind = river_model_t::move_kind;
+        auto tables = std::make_shared<river_model_t::tables_t>();
+        tables->names = _names;
+        tables->capacity = _capacity;
+        tables->all = static_cast<std::uint32_t>((std::uint64_t{1} << _names.size()) - 1);
+        tables->rowers = _rowers;
+        tables->forbidden = _forbidden;
+        tables->moves = {move_t{move_kind::depart, 0}, move_t{move_kind::arrive1, 0}, move_t{move_kind::arrive2, 0}};
+        for (std::size_t actor = 0; actor < _names.size(); ++actor) {
+            auto bit = std::uint32_t{1} << actor;
+            tables->moves.push_back(move_t{move_kind::board, bit});
+            tables->moves.push_back(move_t{move_kind::leave, bit});
+        }
+        if (_names.size() <= river_model_t::table_actors) {
+            tables->groups.resize(std::size_t{1} << _names.size());
+            for (std::size_t group = 0; group < tables->groups.size(); ++group) {
+                tables->groups[group] = river_model_t::group(_forbidden, static_cast<std::uint32_t>(group));
+            }
+        }
+        return river_model_t(std::move(tables));
+    }
+
+private:
+    std::size_t _capacity;
+    std::vector<std::string> _names;
+    std::uint32_t _rowers = 0;
+    std::vector<river_model_t::forbidden_t> _forbidden;
+
+    std::uint32_t mask(std::initializer_list<actor_t> actors) const {
+        std::uint32_t result = 0;
+        for (auto actor: actors) {
+            if (actor >= _names.size())
+                throw std::invalid_argument("unknown river actor " + std::to_string(actor));
+            result |= std::uint32_t{1} << actor;
+        }
+        return result;
+    }
+};
 
 #endif //PUZZLEENGINE_REACHABILITY_HPP